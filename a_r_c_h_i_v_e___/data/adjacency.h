@@ -0,0 +1,108 @@
+#ifndef ADJACENCY_H
+#define ADJACENCY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "edgelist.h"
+#include "parallel.h"
+
+// Contiguous (CSR) adjacency of an undirected simple graph. Neighbours of
+// node i are neighbours[offsets[i]] up to neighbours[offsets[i + 1]], sorted
+// ascending, without repeats and self loops. Repeated edges are counted in
+// weights instead, which is parallel to neighbours.
+struct Adjacency {
+    std::vector<std::size_t> offsets;
+    std::vector<unsigned> neighbours;
+    std::vector<unsigned> weights;
+
+    unsigned nodeCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    std::size_t edgeCount() const { return neighbours.size()/2; }
+    unsigned degree(unsigned i) const { return offsets[i + 1] - offsets[i]; }
+    const unsigned* begin(unsigned i) const { return neighbours.data() + offsets[i]; }
+    const unsigned* end(unsigned i) const { return neighbours.data() + offsets[i + 1]; }
+    // Same as what CompressedAdjacency has, for code taking either
+    void neighboursOf(unsigned i, std::vector<unsigned>& out) const { out.assign(begin(i), end(i)); }
+};
+
+// Edges are scattered in parallel into per-node ranges, which are then
+// sorted, collapsed into weighted neighbours and compacted. threads = 0
+// uses all hardware threads.
+inline Adjacency BuildAdjacency(unsigned nodeCount, const EdgeList& edges, unsigned threads = 0) {
+    if (!threads) threads = DefaultThreadCount();
+
+    std::unique_ptr<std::atomic<std::size_t>[]> cursor(new std::atomic<std::size_t>[nodeCount + 1]);
+    std::atomic<std::size_t>* c = cursor.get();
+    for (std::size_t i = 0; i != std::size_t(nodeCount) + 1; ++i)
+        c[i].store(0, std::memory_order_relaxed);
+    ParallelFor(edges.size(), threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+            if (edges[i].first == edges[i].second) continue;
+            c[edges[i].first + 1].fetch_add(1, std::memory_order_relaxed);
+            c[edges[i].second + 1].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // cursors become range starts, advanced while scattering
+    std::vector<std::size_t> scattered(std::size_t(nodeCount) + 1);
+    for (std::size_t i = 0; i != nodeCount; ++i) {
+        scattered[i + 1] = scattered[i] + c[i + 1].load(std::memory_order_relaxed);
+        c[i].store(scattered[i], std::memory_order_relaxed);
+    }
+    std::vector<unsigned> all(scattered[nodeCount]);
+    ParallelFor(edges.size(), threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+            const unsigned a = edges[i].first, b = edges[i].second;
+            if (a == b) continue;
+            all[c[a].fetch_add(1, std::memory_order_relaxed)] = b;
+            all[c[b].fetch_add(1, std::memory_order_relaxed)] = a;
+        }
+    });
+
+    // collapses runs of the same neighbour in place, their lengths go
+    // to the start of the same range in counts
+    std::vector<unsigned> degrees(nodeCount);
+    std::vector<unsigned> counts(all.size());
+    ParallelFor(nodeCount, threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+            unsigned* first = all.data() + scattered[i];
+            unsigned* last = all.data() + scattered[i + 1];
+            std::sort(first, last);
+            unsigned* count = counts.data() + scattered[i];
+            unsigned unique = 0;
+            for (unsigned* j = first; j != last; ++j) {
+                if (unique && first[unique - 1] == *j) {
+                    ++count[unique - 1];
+                    continue;
+                }
+                first[unique] = *j;
+                count[unique++] = 1;
+            }
+            degrees[i] = unique;
+        }
+    });
+
+    Adjacency out;
+    out.offsets.resize(std::size_t(nodeCount) + 1);
+    for (std::size_t i = 0; i != nodeCount; ++i)
+        out.offsets[i + 1] = out.offsets[i] + degrees[i];
+    out.neighbours.resize(out.offsets[nodeCount]);
+    out.weights.resize(out.offsets[nodeCount]);
+    ParallelFor(nodeCount, threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+            std::copy(all.begin() + scattered[i], all.begin() + scattered[i] + degrees[i],
+                out.neighbours.begin() + out.offsets[i]);
+            std::copy(counts.begin() + scattered[i], counts.begin() + scattered[i] + degrees[i],
+                out.weights.begin() + out.offsets[i]);
+        }
+    });
+    return out;
+}
+
+inline Adjacency BuildAdjacency(const Wgraph& w, unsigned threads = 0) {
+    return BuildAdjacency(w.nodes().size(), WgraphEdges(w), threads);
+}
+
+#endif
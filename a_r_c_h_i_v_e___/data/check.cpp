@@ -0,0 +1,669 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "wgraph.h"
+#include "readfile.h"
+#include "retention.h"
+#include "components.h"
+#include "cores.h"
+#include "compressed.h"
+#include "traversal.h"
+#include "query.h"
+#include "server.h"
+#include "embedding.h"
+#include "hnsw.h"
+
+// Checks the parallel and compressed algorithms against plain sequential
+// versions on random graphs and on the graph of an input file, that embeddings keep
+// apart what isn't connected and that the nearest neighbour index finds
+// what brute force does and survives a save and a load of a bad file. On
+// small hand-written cases, checks how visits are split into sessions and
+// which nodes retention evicts, and runs queries with known results
+// against input.txt, directly and through the server. Prints what failed
+// and exits with 1 if anything did.
+//
+//   g++ -O2 -std=c++11 -pthread -I. check.cpp -o check && ./check input.txt
+
+namespace {
+
+unsigned failures = 0;
+
+void Check(bool ok, const std::string& what) {
+    if (ok) return;
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+}
+
+// n nodes, m edges between random ends, so there are repeats, self loops
+// and, with few edges, isolated nodes
+EdgeList RandomEdges(unsigned n, std::size_t m, unsigned seed) {
+    std::mt19937 random(seed);
+    EdgeList edges;
+    if (!n) return edges;
+    std::uniform_int_distribution<unsigned> node(0, n - 1);
+    for (std::size_t i = 0; i != m; ++i) {
+        const unsigned a = node(random);
+        edges.push_back(std::make_pair(a, node(random)));
+    }
+    return edges;
+}
+
+// Sequential union-find, numbered by lowest node the same way
+std::vector<unsigned> SequentialComponents(unsigned n, const EdgeList& edges) {
+    std::vector<unsigned> parent(n);
+    for (unsigned i = 0; i != n; ++i) parent[i] = i;
+    struct Find {
+        std::vector<unsigned>& parent;
+        unsigned operator()(unsigned x) const {
+            while (parent[x] != x) x = parent[x] = parent[parent[x]];
+            return x;
+        }
+    } find = {parent};
+    for (std::size_t i = 0; i != edges.size(); ++i) {
+        const unsigned a = find(edges[i].first), b = find(edges[i].second);
+        if (a < b) parent[b] = a;
+        else parent[a] = b;
+    }
+    std::vector<unsigned> id(n);
+    unsigned count = 0;
+    for (unsigned i = 0; i != n; ++i) {
+        const unsigned root = find(i);
+        id[i] = root == i ? count++ : id[root];
+    }
+    return id;
+}
+
+void CheckGraph(unsigned n, const EdgeList& edges, const std::string& name) {
+    const unsigned threads[] = {1, 2, 4};
+    const std::vector<unsigned> expected = SequentialComponents(n, edges);
+    for (unsigned t = 0; t != 3; ++t) {
+        const Components components = ConnectedComponents(n, edges, threads[t]);
+        Check(components.id == expected, name + ": components differ from union-find with " + std::to_string(threads[t]) + " threads");
+        std::vector<unsigned> sizes(components.count());
+        for (unsigned i = 0; i != n; ++i) ++sizes[components.id[i]];
+        Check(sizes == components.sizes, name + ": component sizes don't match the IDs");
+    }
+
+    const Adjacency adjacency = BuildAdjacency(n, edges);
+    const Cores cores = CoreDecomposition(adjacency);
+    unsigned degeneracy = 0;
+    for (unsigned i = 0; i != n; ++i) degeneracy = std::max(degeneracy, cores.core[i]);
+    Check(cores.degeneracy == degeneracy, name + ": degeneracy isn't the largest core number");
+    // each node has at least as many neighbours in its core as its number
+    for (unsigned i = 0; i != n; ++i) {
+        unsigned inCore = 0;
+        for (const unsigned* u = adjacency.begin(i); u != adjacency.end(i); ++u)
+            if (cores.core[*u] >= cores.core[i]) ++inCore;
+        if (inCore < cores.core[i]) {
+            Check(false, name + ": node " + std::to_string(i) + " has fewer neighbours in its core than its core number");
+            break;
+        }
+    }
+    for (unsigned t = 0; t != 3; ++t)
+        Check(ParallelCoreNumbers(adjacency, threads[t]) == cores.core, name + ": PKC core numbers differ from BZ with " + std::to_string(threads[t]) + " threads");
+
+    const CompressedAdjacency compressed = CompressAdjacency(adjacency);
+    Check(compressed.nodeCount() == n && compressed.edgeCount() == adjacency.edgeCount(), name + ": compressed counts differ");
+    std::vector<unsigned> plain, packed;
+    for (unsigned i = 0; i != n; ++i) {
+        adjacency.neighboursOf(i, plain);
+        compressed.neighboursOf(i, packed);
+        if (plain != packed) {
+            Check(false, name + ": compressed neighbours of node " + std::to_string(i) + " differ");
+            break;
+        }
+        plain.assign(adjacency.weights.begin() + adjacency.offsets[i], adjacency.weights.begin() + adjacency.offsets[i + 1]);
+        compressed.weightsOf(i, packed);
+        if (plain != packed) {
+            Check(false, name + ": compressed weights of node " + std::to_string(i) + " differ");
+            break;
+        }
+    }
+    if (n) {
+        const unsigned sources[] = {0, n/2, n - 1};
+        for (unsigned s = 0; s != 3; ++s)
+            Check(HopDistances(adjacency, sources[s]) == HopDistances(compressed, sources[s]), name + ": compressed BFS from " + std::to_string(sources[s]) + " differs from CSR BFS");
+    }
+}
+
+float Cosine(const Embedding& e, unsigned a, unsigned b) {
+    float dot = 0.0f, normA = 0.0f, normB = 0.0f;
+    for (unsigned c = 0; c != e.dimensions; ++c) {
+        dot += e[a][c]*e[b][c];
+        normA += e[a][c]*e[a][c];
+        normB += e[b][c]*e[b][c];
+    }
+    return normA > 0.0f && normB > 0.0f ? dot/std::sqrt(normA*normB) : 0.0f;
+}
+
+// Walks never leave a clique, so the most similar node of every node should
+// be in its own one
+void CheckEmbedding(const EmbeddingOptions& options, const std::string& name) {
+    const unsigned cliques = 4, size = 12;
+    EdgeList edges;
+    for (unsigned c = 0; c != cliques; ++c)
+        for (unsigned i = 0; i != size; ++i)
+            for (unsigned j = i + 1; j != size; ++j)
+                edges.push_back(std::make_pair(c*size + i, c*size + j));
+    const Adjacency adjacency = BuildAdjacency(cliques*size, edges);
+    const Embedding e = TrainEmbedding(adjacency, options);
+    Check(e.nodeCount() == cliques*size && e.dimensions == options.dimensions, name + ": wrong embedding size");
+    for (std::size_t i = 0; i != e.vectors.size(); ++i) if (!std::isfinite(e.vectors[i])) {
+        Check(false, name + ": embedding isn't finite");
+        return;
+    }
+
+    unsigned misplaced = 0;
+    for (unsigned v = 0; v != e.nodeCount(); ++v) {
+        unsigned best = v;
+        float bestSimilarity = -2.0f;
+        for (unsigned u = 0; u != e.nodeCount(); ++u) {
+            if (u == v) continue;
+            const float similarity = Cosine(e, v, u);
+            if (similarity > bestSimilarity) {
+                bestSimilarity = similarity;
+                best = u;
+            }
+        }
+        if (best/size != v/size) ++misplaced;
+    }
+    Check(misplaced == 0, name + ": " + std::to_string(misplaced) + " nodes are most similar to a node of another clique");
+
+    // a single thread has no races, so it's reproducible
+    if (options.threads == 1)
+        Check(TrainEmbedding(adjacency, options).vectors == e.vectors, name + ": training twice with one thread differs");
+}
+
+std::string ReadBytes(const std::string& file) {
+    std::ifstream input(file, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+void WriteBytes(const std::string& file, const std::string& bytes) {
+    std::ofstream(file, std::ios::binary).write(bytes.data(), bytes.size());
+}
+
+void CheckHnsw() {
+    const unsigned n = 3000, k = 10;
+    Embedding e;
+    e.dimensions = 16;
+    e.vectors.resize(std::size_t(n)*e.dimensions);
+    std::mt19937 random(11);
+    std::normal_distribution<float> normal;
+    for (std::size_t i = 0; i != e.vectors.size(); ++i) e.vectors[i] = normal(random);
+
+    HnswOptions options;
+    options.threads = 2;
+    Hnsw index(e, options);
+    Check(index.nodeCount() == n && index.dimensions() == e.dimensions, "HNSW: wrong index size");
+
+    // recall of the k nearest against brute force, for every tenth node
+    std::size_t found = 0, total = 0;
+    std::vector<std::pair<float, unsigned> > exact;
+    for (unsigned v = 0; v < n; v += 10) {
+        exact.clear();
+        for (unsigned u = 0; u != n; ++u)
+            if (u != v) exact.push_back(std::make_pair(-Cosine(e, v, u), u));
+        std::partial_sort(exact.begin(), exact.begin() + k, exact.end());
+        const std::vector<std::pair<unsigned, float> > nearest = index.nearest(v, k);
+        Check(nearest.size() == k, "HNSW: fewer than k neighbours of node " + std::to_string(v));
+        for (unsigned i = 0; i != nearest.size(); ++i) {
+            if (std::abs(nearest[i].second - Cosine(e, v, nearest[i].first)) > 1.0e-4f) {
+                Check(false, "HNSW: wrong similarity for node " + std::to_string(v));
+                break;
+            }
+            for (unsigned j = 0; j != k; ++j)
+                if (exact[j].second == nearest[i].first) ++found;
+        }
+        total += k;
+    }
+    Check(found >= total*9/10, "HNSW: recall " + std::to_string(double(found)/total) + " is under 0.9");
+
+    const std::string file = "check.hnsw.tmp";
+    Check(index.save(file), "HNSW: save failed");
+    Hnsw loaded;
+    Check(loaded.load(file) && loaded.nodeCount() == n && loaded.dimensions() == e.dimensions, "HNSW: load of a saved index failed");
+    for (unsigned v = 0; v < n; v += 100)
+        Check(loaded.nearest(v, k) == index.nearest(v, k), "HNSW: loaded index answers differently for node " + std::to_string(v));
+
+    // same layout as save() writes
+    const std::string good = ReadBytes(file);
+    hnsw_detail::FileHeader header;
+    std::memcpy(&header, good.data(), sizeof(header));
+    const std::size_t offsetsStart = sizeof(header) + std::size_t(n)*e.dimensions*sizeof(float);
+    const std::size_t links0Start = offsetsStart + (n + 1)*sizeof(std::uint64_t);
+    struct Corruption {
+        const char* what;
+        std::size_t offset;
+        std::uint64_t value;
+        std::size_t size;
+    } corruptions[] = {
+        {"huge node count", offsetof(hnsw_detail::FileHeader, nodeCount), 0xffffffffu, 4},
+        {"huge dimensions", offsetof(hnsw_detail::FileHeader, dimensions), 0xffffffffu, 4},
+        {"huge m", offsetof(hnsw_detail::FileHeader, m), 0x80000000u, 4},
+        {"huge upper size", offsetof(hnsw_detail::FileHeader, upperSize), 0x4000000000000000ull, 8},
+        {"entry point out of range", offsetof(hnsw_detail::FileHeader, entryPoint), n, 4},
+        {"max level above the entry point", offsetof(hnsw_detail::FileHeader, maxLevel), header.maxLevel + 1, 4},
+        {"upper offsets going back", offsetsStart + sizeof(std::uint64_t), header.upperSize + header.m + 1, 8},
+        {"link out of range", links0Start + sizeof(unsigned), n, 4},
+        {"list over capacity", links0Start, 2*header.m + 1, 4}
+    };
+    for (std::size_t i = 0; i != sizeof(corruptions)/sizeof(corruptions[0]); ++i) {
+        std::string bad = good;
+        std::memcpy(&bad[corruptions[i].offset], &corruptions[i].value, corruptions[i].size);
+        WriteBytes(file, bad);
+        Check(!loaded.load(file), std::string("HNSW: loaded an index with ") + corruptions[i].what);
+    }
+    WriteBytes(file, good.substr(0, good.size() - 4));
+    Check(!loaded.load(file), "HNSW: loaded a truncated index");
+    Check(loaded.nodeCount() == n && loaded.nearest(0u, k) == index.nearest(0u, k), "HNSW: failed load didn't keep the previous index");
+
+    Hnsw empty(Embedding{16, std::vector<float>()});
+    Check(empty.save(file) && loaded.load(file) && loaded.nodeCount() == 0 && loaded.nearest(e[0], k).empty(), "HNSW: empty index doesn't round-trip");
+    std::remove(file.c_str());
+}
+
+// Tags of the visits of each session, sessions separated by "|"
+std::string SessionTags(const Sessions& sessions) {
+    std::string out;
+    for (unsigned i = 0; i != sessions.count(); ++i) {
+        if (i) out += "|";
+        for (unsigned j = 0; j != sessions[i].visits.size(); ++j)
+            out += (j ? " " : "") + sessions.tag(sessions[i].visits[j]);
+    }
+    return out;
+}
+
+EdgeList ReadEdges(const std::string& visits, Sessions& sessions) {
+    std::istringstream input(visits);
+    Wgraph w;
+    ReadVisits(input, w, &sessions);
+    return WgraphEdges(w);
+}
+
+void CheckSessions() {
+    // over 30 minutes without a visit closes the session, even in one tab
+    {
+        Sessions sessions;
+        const EdgeList edges = ReadEdges(
+            "a https://a 0 t1 -\n"
+            "b https://b 60 t1 -\n"
+            "c https://c 4000 t1 -\n"
+            "d https://d 4100 t1 -\n", sessions);
+        Check(SessionTags(sessions) == "a b|c d", "sessions: idle gap gave \"" + SessionTags(sessions) + "\"");
+        Check(edges == EdgeList{{0, 1}, {2, 3}}, "sessions: visits linked over the idle gap");
+        Check(sessions[0].start == 0 && sessions[0].end == 60 && sessions[1].start == 4000, "sessions: wrong start or end times");
+    }
+
+    // b is opened from a in another tab and continues its session, which
+    // c then continues in that tab. e refers to d after the gap, so it's
+    // on its own.
+    {
+        Sessions sessions;
+        const EdgeList edges = ReadEdges(
+            "a https://a 0 t1 -\n"
+            "b https://b 10 t2 a\n"
+            "c https://c 20 t2 -\n"
+            "d https://d 30 t3 -\n"
+            "e https://e 5000 t3 d\n", sessions);
+        Check(SessionTags(sessions) == "a b c|d|e", "sessions: referrer across tabs gave \"" + SessionTags(sessions) + "\"");
+        Check(edges == EdgeList{{0, 1}, {1, 2}}, "sessions: wrong links across tabs");
+        Check(sessions[0].edges == EdgeList{{0, 1}, {1, 2}}, "sessions: wrong session edges across tabs");
+    }
+
+    // Without closed sessions kept, the visit after the 64th session sweeps.
+    // All sessions but the open one are gone then, and the page IDs of
+    // forgotten pages are free for new pages.
+    {
+        SessionOptions options;
+        options.idleGap = 10;
+        options.keepClosed = false;
+        Sessions sessions(options);
+        std::string from;
+        for (unsigned i = 0; i != 64; ++i)
+            sessions.visit("p" + std::to_string(i), i*100, "t" + std::to_string(i), "", from);
+        Check(sessions.count() == 64 && sessions.pageCount() == 64, "sessions: something dropped before the sweep");
+        for (unsigned i = 0; i != 10; ++i) sessions.forget("p" + std::to_string(i));
+        const std::size_t bytes = sessions.memoryBytes();
+
+        Check(sessions.visit("q", 6305, "t63", "", from) && from == "p63", "sessions: open session not continued across the sweep");
+        Check(sessions.count() == 1 && SessionTags(sessions) == "q", "sessions: sweep kept \"" + SessionTags(sessions) + "\"");
+        Check(sessions.memoryBytes() < bytes, "sessions: sweep didn't free memory");
+        Check(!sessions.visit("r", 6310, "t5", "p5", from), "sessions: continued a dropped session from a forgotten page");
+        Check(sessions.pageCount() == 64, "sessions: new pages didn't reuse forgotten IDs");
+        Check(sessions[1].visits.size() == 1 && sessions[1].visits[0] < 10 && sessions.tag(sessions[1].visits[0]) == "r", "sessions: new page didn't get a forgotten page's ID");
+    }
+}
+
+// Every adj entry goes to a node in the graph and its twin is the entry
+// back, so nothing is left pointing to a removed node
+void CheckLinks(const Wgraph& w, const std::string& name) {
+    std::set<const Node*> nodes;
+    for (std::map<std::string,Node*>::const_iterator itr = w.nodes().begin(); itr != w.nodes().end(); itr++)
+        nodes.insert(itr->second);
+    for (std::map<std::string,Node*>::const_iterator itr = w.nodes().begin(); itr != w.nodes().end(); itr++) {
+        const Node* n = itr->second;
+        if (n->adj.size() != n->twins.size()) {
+            Check(false, name + ": " + n->tag + " has " + std::to_string(n->adj.size()) + " adj and " + std::to_string(n->twins.size()) + " twins entries");
+            continue;
+        }
+        std::list<Node::Twin>::const_iterator twin = n->twins.begin();
+        for (std::list<Node*>::const_iterator itr2 = n->adj.begin(); itr2 != n->adj.end(); itr2++, twin++) {
+            if (!nodes.count(*itr2)) Check(false, name + ": " + n->tag + " links to a removed node");
+            else if (*twin->entry != n || &*twin->twin->entry != &*itr2)
+                Check(false, name + ": " + n->tag + " to " + (*itr2)->tag + " has a wrong twin");
+        }
+    }
+}
+
+std::string AdjTags(Wgraph& w, const std::string& tag) {
+    std::string out;
+    const Node* n = w.find(tag);
+    for (std::list<Node*>::const_iterator itr = n->adj.begin(); itr != n->adj.end(); itr++)
+        out += (out.empty() ? "" : " ") + (*itr)->tag;
+    return out;
+}
+
+void AddPage(Wgraph& w, const std::string& tag) {
+    w.add(tag, "https://" + tag, 100);
+}
+
+void CheckRetention() {
+    // removal unlinks both ends of every edge, self loops and repeats too
+    {
+        Wgraph w;
+        AddPage(w, "a");
+        AddPage(w, "b");
+        AddPage(w, "c");
+        w.connect("a", "b");
+        w.connect("b", "c");
+        w.connect("a", "a");
+        w.connect("c", "a");
+        w.connect("a", "b");
+        w.remove("a");
+        Check(!w.find("a") && AdjTags(w, "b") == "c" && AdjTags(w, "c") == "b", "retention: removing a node left \"" + AdjTags(w, "b") + "\" and \"" + AdjTags(w, "c") + "\"");
+        CheckLinks(w, "retention: after removing a node");
+        w.remove("c");
+        Check(AdjTags(w, "b").empty(), "retention: removing the last neighbour left an edge");
+        CheckLinks(w, "retention: after removing two nodes");
+    }
+
+    // all pages cost the same, with tags and links of the same length
+    std::size_t page;
+    {
+        Wgraph w;
+        AddPage(w, "p0");
+        Retention probe(w);
+        probe.visited("p0", 0, false);
+        page = probe.memoryBytes();
+    }
+    const std::size_t edge = 2*Retention::EdgeBytes;
+
+    // Six pages over a budget of five and a half, with a low water mark of
+    // three and a half. The three with the lowest decayed score go, p1 stays
+    // for being visited twice although its first visit is the second
+    // oldest.
+    {
+        const std::string archive = "check.archive.tmp";
+        std::remove(archive.c_str());
+        Wgraph w;
+        RetentionOptions options;
+        options.budget = page*11/2 + edge;
+        options.lowWater = double(page*7/2)/options.budget;
+        options.halfLife = 10.0;
+        options.archive = archive;
+        Retention retention(w, options);
+        const char* visits[] = {"p0", "p1", "p2", "p1", "p3", "p4"};
+        for (unsigned i = 0; i != 6; ++i) {
+            AddPage(w, visits[i]);
+            const bool linked = i == 2;
+            if (linked) w.connect("p2", "p0");
+            retention.visited(visits[i], i, linked);
+        }
+        Check(retention.evictedCount() == 0 && w.nodes().size() == 5, "retention: evicted under the budget");
+
+        AddPage(w, "p5");
+        retention.visited("p5", 6, false);
+        std::string kept;
+        for (std::map<std::string,Node*>::const_iterator itr = w.nodes().begin(); itr != w.nodes().end(); itr++)
+            kept += (kept.empty() ? "" : " ") + itr->first;
+        Check(kept == "p1 p4 p5" && retention.evictedCount() == 3, "retention: kept \"" + kept + "\" instead of \"p1 p4 p5\"");
+        Check(retention.memoryBytes() <= options.budget*options.lowWater, "retention: didn't get under the low water mark");
+        Check(ReadBytes(archive) == "p0 https://p0 p2\np2 https://p2\np3 https://p3\n", "retention: archive is \"" + ReadBytes(archive) + "\"");
+        CheckLinks(w, "retention: after eviction");
+        std::remove(archive.c_str());
+    }
+
+    // The page being visited goes over the budget with the lowest score,
+    // everything else goes instead
+    {
+        Wgraph w;
+        RetentionOptions options;
+        options.budget = page*5/2;
+        options.lowWater = 0.1;
+        Retention retention(w, options);
+        const char* visits[] = {"p7", "p8", "p9"};
+        const double times[] = {10.0, 11.0, 0.0};
+        for (unsigned i = 0; i != 3; ++i) {
+            AddPage(w, visits[i]);
+            retention.visited(visits[i], times[i], false);
+        }
+        Check(w.nodes().size() == 1 && w.find("p9") && retention.evictedCount() == 2, "retention: didn't keep just the page being visited");
+    }
+}
+
+// Tags of a query result, in result order
+std::string RunOn(const QueryGraph& g, const std::string& query) {
+    QueryPlan plan;
+    std::string error;
+    if (!CompileQuery(query, g, plan, error)) return "error";
+    const QuerySelection result = RunQuery(plan, g);
+    std::string out;
+    for (unsigned i = 0; i != result.ids.size(); ++i)
+        out += (i ? " " : "") + g.tags[result.ids[i]];
+    return out;
+}
+
+void CheckQuery(const QueryGraph& g, const std::string& query, const std::string& expected) {
+    const std::string result = RunOn(g, query);
+    Check(result == expected, "query \"" + query + "\" gave \"" + result + "\" instead of \"" + expected + "\"");
+}
+
+// Sends the request from another thread, so a long pipeline can't block
+// both ends, and returns everything received until the server closes
+std::string Exchange(unsigned short port, const std::string& request) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::string out;
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return out;
+    }
+    std::thread sender([fd, &request]() {
+        for (std::size_t sent = 0; sent != request.size(); ) {
+            const ssize_t written = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0) break;
+            sent += written;
+        }
+    });
+    char buffer[4096];
+    for (;;) {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) break;
+        out.append(buffer, received);
+    }
+    sender.join();
+    close(fd);
+    return out;
+}
+
+std::size_t Occurrences(const std::string& s, const std::string& what) {
+    std::size_t count = 0;
+    for (std::size_t i = s.find(what); i != std::string::npos; i = s.find(what, i + 1)) ++count;
+    return count;
+}
+
+void CheckServer(const Wgraph& w, const Sessions& sessions) {
+    // the first free port of a few
+    ServerOptions options;
+    options.threads = 2;
+    std::unique_ptr<GraphServer> server;
+    for (options.port = 18080; options.port != 18090; ++options.port) {
+        server.reset(new GraphServer(options));
+        if (server->start()) break;
+    }
+    if (options.port == 18090) {
+        Check(false, "server: no port to listen on");
+        return;
+    }
+    server->update(w, &sessions);
+    const unsigned short port = options.port;
+    const std::string host = "Host: 127.0.0.1:" + std::to_string(port) + "\r\n";
+
+    std::string response = Exchange(port, "GET /query?q=all&limit=3 HTTP/1.1\r\n" + host + "Connection: close\r\n\r\n");
+    Check(response.compare(0, 15, "HTTP/1.1 200 OK") == 0, "server: query with the right host got \"" + response.substr(0, response.find('\r')) + "\"");
+    Check(response.find("\"count\":9,") != std::string::npos && Occurrences(response, "\"id\":") == 3, "server: query limit not applied");
+    Check(response.find("Access-Control") == std::string::npos, "server: sends CORS headers");
+
+    response = Exchange(port, "GET /clusters HTTP/1.1\r\nHost: LOCALHOST:" + std::to_string(port) + "\r\nConnection: close\r\n\r\n");
+    Check(response.compare(0, 15, "HTTP/1.1 200 OK") == 0, "server: localhost host refused");
+
+    const std::string wrongHosts[] = {
+        "Host: attacker.example:" + std::to_string(port) + "\r\n",
+        "Host: 127.0.0.1\r\n",
+        "Host: 127.0.0.1:" + std::to_string(port) + ".attacker.example\r\n",
+        ""
+    };
+    for (std::size_t i = 0; i != 4; ++i) {
+        response = Exchange(port, "GET /clusters HTTP/1.1\r\n" + wrongHosts[i] + "\r\n");
+        Check(response.compare(0, 22, "HTTP/1.1 403 Forbidden") == 0 && response.find("Connection: close") != std::string::npos, "server: \"" + wrongHosts[i].substr(0, wrongHosts[i].find('\r')) + "\" not refused");
+    }
+
+    // a head that never ends gets the connection closed without an answer
+    response = Exchange(port, "GET /clusters HTTP/1.1\r\n" + host + "X-Padding: " + std::string(4*server_detail::MaxRequestBytes, 'x'));
+    Check(response.empty(), "server: answered an oversized request");
+
+    // more pipelined requests than are read ahead at once, all answered in
+    // order
+    std::string pipeline;
+    const unsigned count = 2000;
+    for (unsigned i = 0; i != count; ++i)
+        pipeline += "GET /query?q=tag+Example" + std::to_string(i % 9 + 1) + "&limit=1 HTTP/1.1\r\n" + host + (i + 1 == count ? "Connection: close\r\n\r\n" : "\r\n");
+    Check(pipeline.size() > server_detail::MaxInputBytes, "server: pipeline shorter than the read-ahead");
+    response = Exchange(port, pipeline);
+    std::string expected, answered;
+    for (unsigned i = 0; i != count; ++i) expected += "Example" + std::to_string(i % 9 + 1) + " ";
+    for (std::size_t i = response.find("\"id\":\""); i != std::string::npos; i = response.find("\"id\":\"", i + 1))
+        answered += response.substr(i + 6, response.find('"', i + 6) - i - 6) + " ";
+    Check(Occurrences(response, "HTTP/1.1 200 OK") == count && answered == expected, "server: " + std::to_string(Occurrences(response, "HTTP/1.1 200 OK")) + " of " + std::to_string(count) + " pipelined requests answered, or out of order");
+}
+
+}
+
+int main(int argc, char * argv[]) {
+
+    if (argc != 2) {
+        std::cerr << "ERROR: usage: check <input file>" << std::endl;
+        exit(1);
+    }
+
+    // few edges for many small components, more for one giant one
+    const unsigned sizes[] = {0, 1, 2, 50, 2000, 30000};
+    for (unsigned i = 0; i != 6; ++i) {
+        CheckGraph(sizes[i], RandomEdges(sizes[i], sizes[i]/3, i), "sparse " + std::to_string(sizes[i]));
+        CheckGraph(sizes[i], RandomEdges(sizes[i], 3*std::size_t(sizes[i]), i), "dense " + std::to_string(sizes[i]));
+    }
+    // a path 0-1-2-3 and 4 on its own, with the edges in both directions
+    const EdgeList path = {{0, 1}, {2, 1}, {2, 3}};
+    const std::vector<unsigned> hops = {0, 1, 2, 3, ~0u};
+    Check(HopDistances(CompressAdjacency(BuildAdjacency(5, path)), 0) == hops, "compressed BFS on a path gives wrong hop counts");
+
+    // high degrees for deep cores, and for weights and degrees that take
+    // more than a byte compressed
+    CheckGraph(300, RandomEdges(300, 60000, 7), "heavy 300");
+
+    EmbeddingOptions deepWalk;
+    deepWalk.dimensions = 16;
+    deepWalk.threads = 1;
+    CheckEmbedding(deepWalk, "DeepWalk");
+    EmbeddingOptions node2vec = deepWalk;
+    node2vec.returnParameter = 4.0f;
+    node2vec.inOutParameter = 0.5f;
+    node2vec.threads = 2;
+    CheckEmbedding(node2vec, "node2vec");
+    CheckHnsw();
+    CheckSessions();
+    CheckRetention();
+
+    Wgraph w;
+    Sessions sessions;
+    ReadFile(std::string(argv[1]), w, &sessions);
+    CheckGraph(w.nodes().size(), WgraphEdges(w), argv[1]);
+
+    // input.txt is a single session of Example1 to Example9 without times,
+    // so a chain in visit order
+    if (std::string(argv[1]).find("input.txt") != std::string::npos) {
+        const QueryGraph g = BuildQueryGraph(w, &sessions);
+        CheckQuery(g, "all", "Example1 Example2 Example3 Example4 Example5 Example6 Example7 Example8 Example9");
+        CheckQuery(g, "tag Example5 | expand 1", "Example4 Example6");
+        CheckQuery(g, "tag Example1 | expand 2 | where degree = 2", "Example2 Example3");
+        CheckQuery(g, "domain example3.com", "Example3");
+        CheckQuery(g, "all | where degree < 2", "Example1 Example9");
+        CheckQuery(g, "all | where domain = example7.com", "Example7");
+        CheckQuery(g, "all | where visits >= 1 | top 2 by degree", "Example2 Example3");
+        CheckQuery(g, "all | after 0", "");
+        CheckQuery(g, "tag Missing | expand 3", "");
+        CheckQuery(g, "all | top 4294967296", "error");
+        CheckQuery(g, "all | expand 1.5", "error");
+        CheckQuery(g, "all | top -1", "error");
+        CheckQuery(g, "all | all", "error");
+        CheckQuery(g, "where degree = 1", "error");
+        CheckQuery(g, "all | | top 1", "error");
+        CheckServer(w, sessions);
+    }
+
+    // the last visit of a is the third one, c is in a session of its own
+    {
+        std::istringstream input(
+            "a https://a 100 t1 -\n"
+            "b https://b 200 t1 -\n"
+            "a https://a 300 t1 -\n"
+            "c https://c 5000 t1 -\n");
+        Wgraph timed;
+        Sessions timedSessions;
+        ReadVisits(input, timed, &timedSessions);
+        const QueryGraph g = BuildQueryGraph(timed, &timedSessions);
+        CheckQuery(g, "all | after 250", "a c");
+        CheckQuery(g, "all | before 250", "b");
+        CheckQuery(g, "all | where visits = 2", "a");
+        CheckQuery(g, "tag c | expand 1", "");
+    }
+
+    if (failures) {
+        std::cerr << failures << " checks failed" << std::endl;
+        exit(1);
+    }
+    std::cout << "all checks passed" << std::endl;
+}
@@ -0,0 +1,136 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "edgelist.h"
+#include "parallel.h"
+
+// Connected components of an undirected graph. Components are numbered in
+// order of their lowest node, isolated nodes are the ones in a component of
+// their own, i.e. without any edge to another node.
+struct Components {
+    std::vector<unsigned> id;       // component of each node
+    std::vector<unsigned> sizes;    // node count of each component
+    std::vector<unsigned> isolated; // nodes with no neighbours, ascending
+
+    unsigned count() const { return sizes.size(); }
+};
+
+namespace components_detail {
+
+// Lock-free union-find. A root is always the lowest node of its set, as
+// unions link the higher root under the lower one, so parents only ever
+// decrease and relaxed atomics are enough.
+inline unsigned FindRoot(std::atomic<unsigned>* parent, unsigned x) {
+    for(;;) {
+        unsigned p = parent[x].load(std::memory_order_relaxed);
+        if (p == x) return x;
+        // path halving, a failed exchange means someone else shortened it
+        unsigned g = parent[p].load(std::memory_order_relaxed);
+        if (p != g)
+            parent[x].compare_exchange_weak(p, g, std::memory_order_relaxed);
+        x = g;
+    }
+}
+
+inline void Unite(std::atomic<unsigned>* parent, unsigned a, unsigned b) {
+    for(;;) {
+        a = FindRoot(parent, a);
+        b = FindRoot(parent, b);
+        if (a == b) return;
+        if (a < b) std::swap(a, b);
+        // a may have been linked by another thread since, retry then
+        unsigned expected = a;
+        if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+            return;
+    }
+}
+
+}
+
+// Afforest-style: unite a sample of the edges first, which already merges
+// most of the giant component in a real graph, then skip every remaining
+// edge with both ends in it and unite the rest. threads = 0 uses all
+// hardware threads.
+inline Components ConnectedComponents(unsigned nodeCount, const EdgeList& edges, unsigned threads = 0) {
+    using namespace components_detail;
+
+    const unsigned SampleStride = 16;
+    const unsigned SampleNodes = 1024;
+
+    if (!threads) threads = DefaultThreadCount();
+
+    std::unique_ptr<std::atomic<unsigned>[]> parent(new std::atomic<unsigned>[nodeCount]);
+    std::atomic<unsigned>* p = parent.get();
+    ParallelFor(nodeCount, threads, [p](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            p[i].store(i, std::memory_order_relaxed);
+    });
+    auto compress = [p](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            p[i].store(FindRoot(p, i), std::memory_order_relaxed);
+    };
+
+    // every SampleStride-th edge
+    const std::size_t sampleCount = (edges.size() + SampleStride - 1)/SampleStride;
+    ParallelFor(sampleCount, threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            Unite(p, edges[i*SampleStride].first, edges[i*SampleStride].second);
+    });
+    ParallelFor(nodeCount, threads, compress);
+
+    // the most frequent root among evenly spread nodes is the giant
+    // component. Its root can still get linked under a lower one later, but
+    // everything pointing to it stays in the same set.
+    unsigned giant = nodeCount;
+    if (nodeCount) {
+        std::unordered_map<unsigned, unsigned> counts;
+        unsigned best = 0;
+        for (unsigned i = 0; i != std::min(SampleNodes, nodeCount); ++i) {
+            const unsigned root = p[std::size_t(i)*nodeCount/std::min(SampleNodes, nodeCount)].load(std::memory_order_relaxed);
+            if (++counts[root] > best) {
+                best = counts[root];
+                giant = root;
+            }
+        }
+    }
+
+    ParallelFor(edges.size(), threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+            if (i % SampleStride == 0) continue;
+            const unsigned a = edges[i].first, b = edges[i].second;
+            if (p[a].load(std::memory_order_relaxed) == giant &&
+                p[b].load(std::memory_order_relaxed) == giant) continue;
+            Unite(p, a, b);
+        }
+    });
+    ParallelFor(nodeCount, threads, compress);
+
+    // roots are the lowest node of each set, so a single ascending pass
+    // numbers a root before any of its members
+    Components out;
+    out.id.resize(nodeCount);
+    for (unsigned i = 0; i != nodeCount; ++i) {
+        const unsigned root = p[i].load(std::memory_order_relaxed);
+        if (root == i) {
+            out.id[i] = out.sizes.size();
+            out.sizes.push_back(0);
+        } else out.id[i] = out.id[root];
+        ++out.sizes[out.id[i]];
+    }
+    for (unsigned i = 0; i != nodeCount; ++i)
+        if (out.sizes[out.id[i]] == 1) out.isolated.push_back(i);
+
+    return out;
+}
+
+inline Components ConnectedComponents(const Wgraph& w, unsigned threads = 0) {
+    return ConnectedComponents(w.nodes().size(), WgraphEdges(w), threads);
+}
+
+#endif
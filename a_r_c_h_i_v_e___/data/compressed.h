@@ -0,0 +1,299 @@
+#ifndef COMPRESSED_H
+#define COMPRESSED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#include "adjacency.h"
+#include "parallel.h"
+
+// Read-only adjacency for cold history, a fraction of the size of Adjacency
+// and far smaller than the lists in Wgraph. Each node is one block of
+// bytes: a varint of the degree times two plus a flag for weights other
+// than one, then the gaps between its sorted neighbours. If flagged, a
+// varint count of such weights and pairs of their position gap and weight
+// minus one follow. Values are stream-vbyte encoded, a 2-bit byte length
+// per value packed four to a control byte followed by the value bytes,
+// which decodes four values at a time with a single shuffle.
+//
+// Only every SampleStride-th block start is stored, the blocks in between
+// are found by skipping, which needs just the control bytes.
+struct CompressedAdjacency {
+    enum { SampleStride = 2 };
+
+    std::vector<std::uint64_t> offsets; // block of node i*SampleStride starts at bytes[offsets[i]]
+    std::vector<std::uint8_t> bytes;    // padded so a decode can read past the end
+    unsigned nodes;
+    std::size_t neighbourCount;
+
+    unsigned nodeCount() const { return nodes; }
+    std::size_t edgeCount() const { return neighbourCount/2; }
+    std::size_t memoryBytes() const { return offsets.size()*sizeof(std::uint64_t) + bytes.size(); }
+
+    // Start of the block of node i
+    const std::uint8_t* block(unsigned i) const;
+    unsigned degree(unsigned i) const;
+    // Replaces out with neighbours of node i, ascending
+    void neighboursOf(unsigned i, std::vector<unsigned>& out) const;
+    // Replaces out with the weights of node i, same order as neighbours
+    void weightsOf(unsigned i, std::vector<unsigned>& out) const;
+};
+
+namespace compressed_detail {
+
+// Trailing bytes so the shuffle can load 16 bytes at any value
+const std::size_t Padding = 16;
+
+inline std::size_t VarintSize(std::uint64_t value) {
+    std::size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+inline std::uint8_t* WriteVarint(std::uint64_t value, std::uint8_t* out) {
+    while (value >= 0x80) {
+        *out++ = std::uint8_t(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = std::uint8_t(value);
+    return out;
+}
+
+inline const std::uint8_t* ReadVarint(const std::uint8_t* in, std::uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; ; shift += 7) {
+        value |= std::uint64_t(*in & 0x7f) << shift;
+        if (!(*in++ & 0x80)) return in;
+    }
+}
+
+inline unsigned ByteLength(unsigned value) {
+    return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+}
+
+inline std::size_t StreamSize(const unsigned* values, std::size_t count) {
+    std::size_t size = (count + 3)/4;
+    for (std::size_t i = 0; i != count; ++i) size += ByteLength(values[i]);
+    return size;
+}
+
+inline std::uint8_t* WriteStream(const unsigned* values, std::size_t count, std::uint8_t* out) {
+    std::uint8_t* control = out;
+    std::uint8_t* data = out + (count + 3)/4;
+    for (std::size_t i = 0; i != (count + 3)/4; ++i) control[i] = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        const unsigned length = ByteLength(values[i]);
+        control[i/4] |= (length - 1) << 2*(i%4);
+        for (unsigned b = 0; b != length; ++b) *data++ = std::uint8_t(values[i] >> 8*b);
+    }
+    return data;
+}
+
+// End of a stream of count values, reading only its control bytes
+inline const std::uint8_t* SkipStream(const std::uint8_t* in, std::size_t count) {
+    const std::uint8_t* control = in;
+    const std::uint8_t* data = in + (count + 3)/4;
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const unsigned c = control[i/4];
+        data += (c & 3) + (c >> 2 & 3) + (c >> 4 & 3) + (c >> 6) + 4;
+    }
+    for (; i != count; ++i) data += ((control[i/4] >> 2*(i%4)) & 3) + 1;
+    return data;
+}
+
+// Given a block, returns the start of the next one
+inline const std::uint8_t* SkipBlock(const std::uint8_t* in) {
+    std::uint64_t header;
+    in = ReadVarint(in, header);
+    in = SkipStream(in, header >> 1);
+    if (header & 1) {
+        std::uint64_t weighted;
+        in = ReadVarint(in, weighted);
+        in = SkipStream(in, 2*weighted);
+    }
+    return in;
+}
+
+#ifdef __SSSE3__
+// Shuffle moving the value bytes of each control byte into four 32-bit
+// lanes, and the number of bytes they take
+struct ShuffleTable {
+    ShuffleTable() {
+        for (unsigned c = 0; c != 256; ++c) {
+            unsigned position = 0;
+            for (unsigned v = 0; v != 4; ++v) {
+                const unsigned length = ((c >> 2*v) & 3) + 1;
+                for (unsigned b = 0; b != 4; ++b)
+                    shuffle[c][4*v + b] = b < length ? std::uint8_t(position + b) : 0x80;
+                position += length;
+            }
+            lengths[c] = position;
+        }
+    }
+
+    std::uint8_t shuffle[256][16];
+    std::uint8_t lengths[256];
+};
+
+inline const ShuffleTable& Shuffles() {
+    static const ShuffleTable table;
+    return table;
+}
+#endif
+
+// Decodes count values to out, running sums of them if delta is set.
+// Returns the end of the stream.
+inline const std::uint8_t* ReadStream(const std::uint8_t* in, std::size_t count, unsigned* out, bool delta) {
+    const std::uint8_t* control = in;
+    const std::uint8_t* data = in + (count + 3)/4;
+    std::size_t i = 0;
+    unsigned previous = 0;
+#ifdef __SSSE3__
+    const ShuffleTable& table = Shuffles();
+    __m128i carry = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        const std::uint8_t c = control[i/4];
+        __m128i values = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.shuffle[c])));
+        data += table.lengths[c];
+        if (delta) {
+            // prefix sum of the four lanes, plus the last sum so far
+            values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+            values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+            values = _mm_add_epi32(values, carry);
+            carry = _mm_shuffle_epi32(values, 0xff);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), values);
+    }
+    if (delta && i) previous = out[i - 1];
+#endif
+    for (; i != count; ++i) {
+        const unsigned length = ((control[i/4] >> 2*(i%4)) & 3) + 1;
+        unsigned value = 0;
+        for (unsigned b = 0; b != length; ++b) value |= unsigned(*data++) << 8*b;
+        if (delta) value = previous += value;
+        out[i] = value;
+    }
+    return data;
+}
+
+}
+
+inline const std::uint8_t* CompressedAdjacency::block(unsigned i) const {
+    const std::uint8_t* in = bytes.data() + offsets[i/SampleStride];
+    for (unsigned skip = i%SampleStride; skip; --skip) in = compressed_detail::SkipBlock(in);
+    return in;
+}
+
+inline unsigned CompressedAdjacency::degree(unsigned i) const {
+    std::uint64_t header;
+    compressed_detail::ReadVarint(block(i), header);
+    return header >> 1;
+}
+
+inline void CompressedAdjacency::neighboursOf(unsigned i, std::vector<unsigned>& out) const {
+    std::uint64_t header;
+    const std::uint8_t* in = compressed_detail::ReadVarint(block(i), header);
+    out.resize(header >> 1);
+    compressed_detail::ReadStream(in, out.size(), out.data(), true);
+}
+
+inline void CompressedAdjacency::weightsOf(unsigned i, std::vector<unsigned>& out) const {
+    std::uint64_t header;
+    const std::uint8_t* in = compressed_detail::ReadVarint(block(i), header);
+    out.assign(header >> 1, 1);
+    if (!(header & 1)) return;
+
+    std::uint64_t weighted;
+    in = compressed_detail::SkipStream(in, out.size());
+    in = compressed_detail::ReadVarint(in, weighted);
+    std::vector<unsigned> pairs(2*weighted);
+    compressed_detail::ReadStream(in, pairs.size(), pairs.data(), false);
+    std::size_t position = 0;
+    for (std::size_t j = 0; j != pairs.size(); j += 2) {
+        position += pairs[j];
+        out[position] += pairs[j + 1];
+    }
+}
+
+// Blocks are sized in parallel, then written in parallel to where the
+// sizes put them. threads = 0 uses all hardware threads.
+inline CompressedAdjacency CompressAdjacency(const Adjacency& a, unsigned threads = 0) {
+    using namespace compressed_detail;
+    if (!threads) threads = DefaultThreadCount();
+
+    const unsigned n = a.nodeCount();
+    const unsigned Stride = CompressedAdjacency::SampleStride;
+    CompressedAdjacency out;
+    out.nodes = n;
+    out.neighbourCount = a.neighbours.size();
+
+    // gaps of given node, and pairs of position gap and weight minus one
+    // for weights other than one, reusing the buffers
+    auto prepare = [&a](unsigned v, std::vector<unsigned>& gaps, std::vector<unsigned>& weights) {
+        const std::size_t degree = a.degree(v);
+        const unsigned* neighbours = a.begin(v);
+        gaps.resize(degree);
+        weights.clear();
+        std::size_t previous = 0;
+        for (std::size_t i = 0; i != degree; ++i) {
+            gaps[i] = i ? neighbours[i] - neighbours[i - 1] : neighbours[i];
+            const unsigned weight = a.weights[a.offsets[v] + i];
+            if (weight == 1) continue;
+            weights.push_back(i - previous);
+            weights.push_back(weight - 1);
+            previous = i;
+        }
+    };
+    auto blockSize = [](const std::vector<unsigned>& gaps, const std::vector<unsigned>& weights) {
+        const bool weighted = !weights.empty();
+        return VarintSize(2*gaps.size() + weighted) + StreamSize(gaps.data(), gaps.size()) +
+            (weighted ? VarintSize(weights.size()/2) + StreamSize(weights.data(), weights.size()) : 0);
+    };
+
+    // sizes of whole sampled groups, turned into their starts
+    const std::size_t groups = (std::size_t(n) + Stride - 1)/Stride;
+    out.offsets.assign(groups + 1, 0);
+    ParallelFor(groups, threads, [&](std::size_t begin, std::size_t end) {
+        std::vector<unsigned> gaps, weights;
+        for (std::size_t g = begin; g != end; ++g)
+            for (std::size_t v = g*Stride; v != std::min<std::size_t>((g + 1)*Stride, n); ++v) {
+                prepare(v, gaps, weights);
+                out.offsets[g + 1] += blockSize(gaps, weights);
+            }
+    });
+    for (std::size_t g = 0; g != groups; ++g) out.offsets[g + 1] += out.offsets[g];
+
+    out.bytes.assign(out.offsets[groups] + Padding, 0);
+    ParallelFor(groups, threads, [&](std::size_t begin, std::size_t end) {
+        std::vector<unsigned> gaps, weights;
+        for (std::size_t g = begin; g != end; ++g) {
+            std::uint8_t* data = out.bytes.data() + out.offsets[g];
+            for (std::size_t v = g*Stride; v != std::min<std::size_t>((g + 1)*Stride, n); ++v) {
+                prepare(v, gaps, weights);
+                const bool weighted = !weights.empty();
+                data = WriteVarint(2*gaps.size() + weighted, data);
+                data = WriteStream(gaps.data(), gaps.size(), data);
+                if (weighted) {
+                    data = WriteVarint(weights.size()/2, data);
+                    data = WriteStream(weights.data(), weights.size(), data);
+                }
+            }
+        }
+    });
+    return out;
+}
+
+inline CompressedAdjacency CompressAdjacency(const Wgraph& w, unsigned threads = 0) {
+    return CompressAdjacency(BuildAdjacency(w, threads), threads);
+}
+
+#endif
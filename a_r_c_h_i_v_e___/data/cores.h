@@ -0,0 +1,201 @@
+#ifndef CORES_H
+#define CORES_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "adjacency.h"
+#include "components.h"
+#include "parallel.h"
+
+// k-core decomposition. The core number of a node is the largest k such
+// that it's in a subgraph where every node has at least k neighbours. The
+// degeneracy is the largest core number in the graph.
+struct Cores {
+    std::vector<unsigned> core;  // core number of each node
+    std::vector<unsigned> order; // peeling order, by ascending core number
+    unsigned degeneracy;
+};
+
+// Batagelj-Zaversnik: nodes in buckets by remaining degree, always peeling
+// the lowest one, O(nodes + edges).
+inline Cores CoreDecomposition(const Adjacency& a) {
+    const unsigned n = a.nodeCount();
+    Cores out;
+    out.core.resize(n);
+    out.order.resize(n);
+    out.degeneracy = 0;
+    if (!n) return out;
+
+    // order is kept sorted by remaining degree, with bucketStart the first
+    // position of each degree and position the inverse of order
+    unsigned maxDegree = 0;
+    for (unsigned i = 0; i != n; ++i) {
+        out.core[i] = a.degree(i);
+        maxDegree = std::max(maxDegree, out.core[i]);
+    }
+    std::vector<unsigned> bucketStart(maxDegree + 2);
+    for (unsigned i = 0; i != n; ++i) ++bucketStart[out.core[i] + 1];
+    for (unsigned d = 0; d != maxDegree + 1; ++d) bucketStart[d + 1] += bucketStart[d];
+    std::vector<unsigned> position(n);
+    {
+        std::vector<unsigned> next(bucketStart.begin(), bucketStart.end() - 1);
+        for (unsigned i = 0; i != n; ++i) {
+            position[i] = next[out.core[i]]++;
+            out.order[position[i]] = i;
+        }
+    }
+
+    for (unsigned p = 0; p != n; ++p) {
+        const unsigned v = out.order[p];
+        const unsigned k = out.core[v];
+        out.degeneracy = std::max(out.degeneracy, k);
+        for (const unsigned* u = a.begin(v); u != a.end(v); ++u) {
+            const unsigned du = out.core[*u];
+            if (du <= k) continue;
+            // swap u with the first node of its bucket and shrink the
+            // bucket by one, which moves u to the end of the one below
+            const unsigned w = out.order[bucketStart[du]];
+            if (w != *u) {
+                std::swap(out.order[position[*u]], out.order[bucketStart[du]]);
+                std::swap(position[*u], position[w]);
+            }
+            ++bucketStart[du];
+            --out.core[*u];
+        }
+    }
+    return out;
+}
+
+// Level-synchronous peeling (PKC). All nodes of the current level are
+// removed in parallel, neighbours whose degree falls to the level join the
+// next round of it, and once it's exhausted the level jumps to the lowest
+// remaining degree. Gives only core numbers, threads = 0 uses all hardware
+// threads.
+inline std::vector<unsigned> ParallelCoreNumbers(const Adjacency& a, unsigned threads = 0) {
+    const unsigned Unset = ~0u;
+    if (!threads) threads = DefaultThreadCount();
+
+    const unsigned n = a.nodeCount();
+    std::unique_ptr<std::atomic<unsigned>[]> degreeStorage(new std::atomic<unsigned>[n]);
+    std::atomic<unsigned>* degree = degreeStorage.get();
+    std::vector<unsigned> core(n, Unset);
+    std::vector<unsigned> remaining(n);
+    for (unsigned i = 0; i != n; ++i) {
+        degree[i].store(a.degree(i), std::memory_order_relaxed);
+        remaining[i] = i;
+    }
+
+    std::mutex mutex;
+    std::vector<unsigned> frontier, next;
+    while (!remaining.empty()) {
+        unsigned k = ~0u;
+        for (unsigned i = 0; i != remaining.size(); ++i)
+            k = std::min(k, degree[remaining[i]].load(std::memory_order_relaxed));
+
+        frontier.clear();
+        std::size_t kept = 0;
+        for (unsigned i = 0; i != remaining.size(); ++i) {
+            const unsigned v = remaining[i];
+            if (degree[v].load(std::memory_order_relaxed) <= k) {
+                core[v] = k;
+                frontier.push_back(v);
+            } else remaining[kept++] = v;
+        }
+        remaining.resize(kept);
+
+        while (!frontier.empty()) {
+            next.clear();
+            ParallelFor(frontier.size(), threads, [&](std::size_t begin, std::size_t end) {
+                std::vector<unsigned> local;
+                for (std::size_t i = begin; i != end; ++i) {
+                    const unsigned v = frontier[i];
+                    for (const unsigned* u = a.begin(v); u != a.end(v); ++u) {
+                        if (degree[*u].load(std::memory_order_relaxed) <= k) continue;
+                        const unsigned previous = degree[*u].fetch_sub(1, std::memory_order_relaxed);
+                        // exactly one decrement crosses into the level,
+                        // others racing past it are undone
+                        if (previous == k + 1) local.push_back(*u);
+                        else if (previous <= k) degree[*u].fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                next.insert(next.end(), local.begin(), local.end());
+            });
+            for (unsigned i = 0; i != next.size(); ++i) core[next[i]] = k;
+            std::swap(frontier, next);
+        }
+
+        // drop what the rounds above peeled
+        kept = 0;
+        for (unsigned i = 0; i != remaining.size(); ++i)
+            if (core[remaining[i]] == Unset) remaining[kept++] = remaining[i];
+        remaining.resize(kept);
+    }
+    return core;
+}
+
+struct DenseSubgraph {
+    std::vector<unsigned> nodes; // ascending
+    double density;              // edges per node
+};
+
+// Charikar's greedy peeling: of all suffixes of the peeling order, the
+// densest one is within a factor of two of the densest subgraph.
+inline DenseSubgraph DensestSubgraph(const Adjacency& a, const Cores& cores) {
+    const unsigned n = a.nodeCount();
+    DenseSubgraph out;
+    out.density = 0.0;
+    if (!n) return out;
+
+    std::vector<unsigned> position(n);
+    for (unsigned p = 0; p != n; ++p) position[cores.order[p]] = p;
+
+    // adding nodes back in reverse, each brings its edges to nodes peeled
+    // after it
+    std::size_t edges = 0;
+    unsigned best = n;
+    for (unsigned p = n; p-- != 0; ) {
+        const unsigned v = cores.order[p];
+        for (const unsigned* u = a.begin(v); u != a.end(v); ++u)
+            if (position[*u] > p) ++edges;
+        const double density = double(edges)/(n - p);
+        if (density > out.density) {
+            out.density = density;
+            best = p;
+        }
+    }
+
+    out.nodes.assign(cores.order.begin() + best, cores.order.end());
+    std::sort(out.nodes.begin(), out.nodes.end());
+    return out;
+}
+
+// Rabbit holes: tightly knit groups of pages visited in a loop, found as
+// the connected pieces of the subgraph of nodes with core number of at least
+// minCore. Largest first, nodes in each ascending.
+inline std::vector<std::vector<unsigned> > RabbitHoles(const Adjacency& a, const std::vector<unsigned>& core, unsigned minCore) {
+    const unsigned n = a.nodeCount();
+    EdgeList edges;
+    for (unsigned v = 0; v != n; ++v) {
+        if (core[v] < minCore) continue;
+        for (const unsigned* u = a.begin(v); u != a.end(v); ++u)
+            if (*u > v && core[*u] >= minCore) edges.push_back(std::make_pair(v, *u));
+    }
+    const Components components = ConnectedComponents(n, edges);
+
+    std::vector<std::vector<unsigned> > out(components.count());
+    for (unsigned v = 0; v != n; ++v)
+        if (core[v] >= minCore) out[components.id[v]].push_back(v);
+    out.erase(std::remove_if(out.begin(), out.end(), [](const std::vector<unsigned>& hole) {
+        return hole.size() < 2;
+    }), out.end());
+    std::stable_sort(out.begin(), out.end(), [](const std::vector<unsigned>& a, const std::vector<unsigned>& b) {
+        return a.size() > b.size();
+    });
+    return out;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef EDGELIST_H
+#define EDGELIST_H
+
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "wgraph.h"
+
+// Undirected edges as pairs of node IDs
+typedef std::vector<std::pair<unsigned, unsigned> > EdgeList;
+
+// Node IDs are positions in Wgraph::nodes() iteration order, same as in the
+// viewer. Node::adj has an entry per connect() in both directions, only the
+// one from the lower end is listed, repeats included.
+inline EdgeList WgraphEdges(const Wgraph& w) {
+    const std::map<std::string,Node*>& nodes = w.nodes();
+    std::unordered_map<const Node*, unsigned> ids;
+    ids.reserve(nodes.size());
+    for (std::map<std::string,Node*>::const_iterator itr = nodes.begin(); itr != nodes.end(); itr++)
+        ids.emplace(itr->second, ids.size());
+
+    EdgeList edges;
+    for (std::map<std::string,Node*>::const_iterator itr = nodes.begin(); itr != nodes.end(); itr++) {
+        const unsigned a = ids.at(itr->second);
+        for (std::list<Node*>::const_iterator itr2 = itr->second->adj.begin(); itr2 != itr->second->adj.end(); itr2++) {
+            const unsigned b = ids.at(*itr2);
+            if (a < b) edges.push_back(std::make_pair(a, b));
+        }
+    }
+    return edges;
+}
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef EMBEDDING_H
+#define EMBEDDING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "adjacency.h"
+#include "parallel.h"
+
+// Node embeddings from random walks (DeepWalk, or node2vec with p and q
+// other than 1) trained with skip-gram and negative sampling. Nodes that
+// tend to appear close to each other on walks end up with similar vectors,
+// which is what "related pages" is looked up by.
+struct EmbeddingOptions {
+    EmbeddingOptions(): dimensions(64), walksPerNode(10), walkLength(40),
+        window(5), negatives(5), learningRate(0.025f), returnParameter(1.0f),
+        inOutParameter(1.0f), threads(0), seed(1) {}
+
+    unsigned dimensions;
+    unsigned walksPerNode;
+    unsigned walkLength;
+    unsigned window;          // context nodes on either side
+    unsigned negatives;       // negative samples per context node
+    float learningRate;       // decays linearly to zero over the training
+    float returnParameter;    // node2vec p, higher makes going back rarer
+    float inOutParameter;     // node2vec q, higher keeps walks local
+    unsigned threads;         // 0 uses all hardware threads
+    std::uint64_t seed;
+};
+
+struct Embedding {
+    unsigned dimensions;
+    std::vector<float> vectors; // nodeCount*dimensions
+
+    unsigned nodeCount() const { return dimensions ? vectors.size()/dimensions : 0; }
+    const float* operator[](unsigned i) const { return vectors.data() + std::size_t(i)*dimensions; }
+};
+
+namespace embedding_detail {
+
+// SplitMix64, one per thread
+struct Random {
+    explicit Random(std::uint64_t seed): state(seed) {}
+
+    std::uint64_t next() {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    // [0, 1)
+    float uniform() { return (next() >> 40)*(1.0f/16777216.0f); }
+    // [0, n)
+    std::size_t below(std::size_t n) { return (next() >> 32)*n >> 32; }
+
+    std::uint64_t state;
+};
+
+// Walker's alias method, built with Vose's algorithm. Sampling is a
+// uniform pick of a slot, which either keeps its own item or gives its
+// alias. Tables of all nodes share one array, aligned with the adjacency.
+inline void BuildAlias(const unsigned* weights, std::size_t count, float* probability, unsigned* alias, std::vector<float>& scaled, std::vector<unsigned>& small, std::vector<unsigned>& large) {
+    double sum = 0.0;
+    for (std::size_t i = 0; i != count; ++i) sum += weights[i];
+    scaled.resize(count);
+    small.clear();
+    large.clear();
+    for (std::size_t i = 0; i != count; ++i) {
+        scaled[i] = float(weights[i]*count/sum);
+        (scaled[i] < 1.0f ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        const unsigned s = small.back(), l = large.back();
+        small.pop_back();
+        probability[s] = scaled[s];
+        alias[s] = l;
+        scaled[l] -= 1.0f - scaled[s];
+        if (scaled[l] < 1.0f) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // leftovers are 1 up to rounding
+    for (std::size_t i = 0; i != small.size(); ++i) probability[small[i]] = 1.0f;
+    for (std::size_t i = 0; i != large.size(); ++i) probability[large[i]] = 1.0f;
+}
+
+inline std::size_t SampleAlias(Random& random, std::size_t count, const float* probability, const unsigned* alias) {
+    const std::size_t i = random.below(count);
+    return random.uniform() < probability[i] ? i : alias[i];
+}
+
+inline float Sigmoid(float x) {
+    if (x > 6.0f) return 1.0f;
+    if (x < -6.0f) return 0.0f;
+    return 1.0f/(1.0f + std::exp(-x));
+}
+
+}
+
+// Every thread walks from its share of nodes and trains on each walk as
+// soon as it's generated. Updates to the shared vectors are unsynchronized
+// (Hogwild), collisions are rare enough on sparse graphs not to matter.
+//
+// Transitions are proportional to edge weights. For node2vec, the
+// second-order bias is applied by rejection against the first-order alias
+// tables, so there's no per-edge table and memory stays linear in edges.
+inline Embedding TrainEmbedding(const Adjacency& a, const EmbeddingOptions& options = EmbeddingOptions()) {
+    using namespace embedding_detail;
+
+    const unsigned n = a.nodeCount();
+    const unsigned d = options.dimensions;
+    const unsigned threads = options.threads ? options.threads : DefaultThreadCount();
+
+    Embedding out;
+    out.dimensions = d;
+    out.vectors.resize(std::size_t(n)*d);
+    std::vector<float> context(std::size_t(n)*d, 0.0f);
+
+    // word2vec init, small random input vectors and zero output ones
+    ParallelFor(n, threads, [&](std::size_t begin, std::size_t end) {
+        Random random(options.seed ^ (begin*0x2545f4914f6cdd1dull));
+        for (std::size_t i = begin*d; i != end*d; ++i)
+            out.vectors[i] = (random.uniform() - 0.5f)/d;
+    });
+
+    std::vector<float> probability(a.neighbours.size());
+    std::vector<unsigned> alias(a.neighbours.size());
+    ParallelFor(n, threads, [&](std::size_t begin, std::size_t end) {
+        std::vector<float> scaled;
+        std::vector<unsigned> small, large;
+        for (std::size_t v = begin; v != end; ++v)
+            BuildAlias(a.weights.data() + a.offsets[v], a.degree(v),
+                probability.data() + a.offsets[v], alias.data() + a.offsets[v],
+                scaled, small, large);
+    });
+
+    // negatives are drawn by visit count to the power of 0.75
+    std::vector<unsigned> frequency(n);
+    for (unsigned v = 0; v != n; ++v) {
+        std::size_t visits = 0;
+        for (std::size_t i = a.offsets[v]; i != a.offsets[v + 1]; ++i) visits += a.weights[i];
+        frequency[v] = std::max(1u, unsigned(std::pow(double(visits), 0.75)));
+    }
+    std::vector<float> noiseProbability(n);
+    std::vector<unsigned> noiseAlias(n);
+    {
+        std::vector<float> scaled;
+        std::vector<unsigned> small, large;
+        BuildAlias(frequency.data(), n, noiseProbability.data(), noiseAlias.data(), scaled, small, large);
+    }
+
+    const bool biased = options.returnParameter != 1.0f || options.inOutParameter != 1.0f;
+    const float returnBias = 1.0f/options.returnParameter;
+    const float outBias = 1.0f/options.inOutParameter;
+    const float maxBias = std::max(1.0f, std::max(returnBias, outBias));
+
+    const std::size_t totalWalks = std::size_t(n)*options.walksPerNode;
+    std::atomic<std::size_t> walksDone(0);
+
+    ParallelFor(n, threads, [&](std::size_t begin, std::size_t end) {
+        Random random(options.seed + begin + 1);
+        std::vector<unsigned> walk;
+        walk.reserve(options.walkLength);
+        std::vector<float> gradient(d);
+
+        for (unsigned pass = 0; pass != options.walksPerNode; ++pass) for (std::size_t start = begin; start != end; ++start) {
+            // walk
+            walk.clear();
+            walk.push_back(start);
+            while (walk.size() < options.walkLength) {
+                const unsigned v = walk.back();
+                const std::size_t degree = a.degree(v);
+                if (!degree) break;
+                const std::size_t offset = a.offsets[v];
+                unsigned next;
+                for (;;) {
+                    next = a.neighbours[offset + SampleAlias(random, degree, probability.data() + offset, alias.data() + offset)];
+                    if (!biased || walk.size() < 2) break;
+                    const unsigned previous = walk[walk.size() - 2];
+                    const float bias = next == previous ? returnBias :
+                        std::binary_search(a.begin(previous), a.end(previous), next) ? 1.0f : outBias;
+                    if (random.uniform()*maxBias < bias) break;
+                }
+                walk.push_back(next);
+            }
+
+            const float rate = std::max(options.learningRate*0.0001f,
+                options.learningRate*(1.0f - float(walksDone.fetch_add(1, std::memory_order_relaxed))/totalWalks));
+
+            // skip-gram over the walk, with the window randomly shrunk so
+            // closer nodes weigh more, same as word2vec
+            for (std::size_t i = 0; i != walk.size(); ++i) {
+                const std::size_t shrink = random.below(options.window);
+                const std::size_t first = i > options.window - shrink ? i - (options.window - shrink) : 0;
+                const std::size_t last = std::min(walk.size(), i + options.window - shrink + 1);
+                for (std::size_t j = first; j != last; ++j) {
+                    if (j == i) continue;
+                    float* input = out.vectors.data() + std::size_t(walk[j])*d;
+                    std::fill(gradient.begin(), gradient.end(), 0.0f);
+                    for (unsigned k = 0; k != options.negatives + 1; ++k) {
+                        unsigned target;
+                        float label;
+                        if (k == 0) {
+                            target = walk[i];
+                            label = 1.0f;
+                        } else {
+                            target = SampleAlias(random, n, noiseProbability.data(), noiseAlias.data());
+                            if (target == walk[i]) continue;
+                            label = 0.0f;
+                        }
+                        float* output = context.data() + std::size_t(target)*d;
+                        float dot = 0.0f;
+                        for (unsigned c = 0; c != d; ++c) dot += input[c]*output[c];
+                        const float g = (label - Sigmoid(dot))*rate;
+                        for (unsigned c = 0; c != d; ++c) gradient[c] += g*output[c];
+                        for (unsigned c = 0; c != d; ++c) output[c] += g*input[c];
+                    }
+                    for (unsigned c = 0; c != d; ++c) input[c] += gradient[c];
+                }
+            }
+        }
+    });
+
+    return out;
+}
+
+#endif
@@ -0,0 +1,547 @@
+#ifndef HNSW_H
+#define HNSW_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+#include "embedding.h"
+#include "parallel.h"
+
+// Approximate nearest neighbours of node vectors by cosine similarity, with
+// a hierarchical navigable small world graph (Malkov & Yashunin). Every node
+// links to up to 2*m close nodes on the bottom layer and up to m on each
+// upper layer it's in, with exponentially fewer nodes on each. Queries
+// descend greedily from the top and widen to ef candidates at the bottom.
+struct HnswOptions {
+    HnswOptions(): m(16), efConstruction(200), threads(0), seed(1) {}
+
+    unsigned m;              // links per node on upper layers
+    unsigned efConstruction; // candidates considered when linking a node
+    unsigned threads;        // 0 uses all hardware threads
+    std::uint64_t seed;
+};
+
+namespace hnsw_detail {
+
+inline float Dot(const float* a, const float* b, unsigned d) {
+    float sum = 0.0f;
+    unsigned i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    for (; i + 16 <= d; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    for (; i + 8 <= d; i += 8)
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    sum0 = _mm256_add_ps(sum0, sum1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    sum = _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+#else
+    // independent sums, so the compiler doesn't serialize on one
+    float sums[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (; i + 4 <= d; i += 4)
+        for (unsigned j = 0; j != 4; ++j) sums[j] += a[i + j]*b[i + j];
+    sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif
+    for (; i != d; ++i) sum += a[i]*b[i];
+    return sum;
+}
+
+inline void Normalize(float* v, unsigned d) {
+    const float length = std::sqrt(Dot(v, v, d));
+    if (length > 0.0f) for (unsigned i = 0; i != d; ++i) v[i] /= length;
+}
+
+// Marks of visited nodes, cleared by bumping the generation instead of
+// touching all of them. One per thread, shared by all indices.
+struct Visited {
+    Visited(): generation(0) {}
+
+    void reset(std::size_t nodeCount) {
+        if (marks.size() < nodeCount || ++generation == 0) {
+            marks.assign(std::max(nodeCount, marks.size()), 0);
+            generation = 1;
+        }
+    }
+    // true the first time since reset()
+    bool visit(unsigned v) {
+        if (marks[v] == generation) return false;
+        marks[v] = generation;
+        return true;
+    }
+
+    std::vector<unsigned> marks;
+    unsigned generation;
+};
+
+inline Visited& ThreadVisited() {
+    thread_local Visited visited;
+    return visited;
+}
+
+// distance, node
+typedef std::pair<float, unsigned> Candidate;
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t dimensions;
+    std::uint32_t nodeCount;
+    std::uint32_t m;
+    std::uint32_t maxLevel;
+    std::uint32_t entryPoint;
+    std::uint32_t reserved;
+    std::uint64_t upperSize;
+};
+
+const char FileMagic[8] = {'B', 'C', 'H', 'N', 'S', 'W', '1', '\0'};
+
+// a*b + c, false if it doesn't fit. Sizes in a file header can be anything.
+inline bool MultiplyAdd(std::uint64_t a, std::uint64_t b, std::uint64_t c, std::uint64_t& out) {
+    if (b && a > (std::numeric_limits<std::uint64_t>::max() - c)/b) return false;
+    out = a*b + c;
+    return true;
+}
+
+// Everything a query follows has to stay inside the file. Upper layer
+// ranges are whole layers in ascending order, the entry point is on the top
+// one, no list is over capacity and every link goes to a node that's on
+// the same layer.
+inline bool ValidLinks(const FileHeader& header, const std::uint64_t* upperOffsets, const unsigned* links0, const unsigned* upper) {
+    const std::uint64_t count = header.nodeCount;
+    const std::uint64_t stride = std::uint64_t(header.m) + 1;
+    if (upperOffsets[0] != 0 || upperOffsets[count] != header.upperSize) return false;
+    if (!count) return header.entryPoint == 0 && header.maxLevel == 0;
+    if (header.entryPoint >= count) return false;
+    for (std::uint64_t v = 0; v != count; ++v)
+        if (upperOffsets[v + 1] < upperOffsets[v] || (upperOffsets[v + 1] - upperOffsets[v]) % stride != 0 ||
+            (upperOffsets[v + 1] - upperOffsets[v])/stride > header.maxLevel)
+            return false;
+    struct Level {
+        const std::uint64_t* offsets;
+        std::uint64_t stride;
+        std::uint64_t operator()(std::uint64_t v) const { return (offsets[v + 1] - offsets[v])/stride; }
+    } level = {upperOffsets, stride};
+    if (level(header.entryPoint) != header.maxLevel) return false;
+
+    for (std::uint64_t v = 0; v != count; ++v) {
+        const unsigned* list = links0 + v*(2*stride - 1);
+        if (list[0] > 2*stride - 2) return false;
+        for (unsigned i = 1; i <= list[0]; ++i)
+            if (list[i] >= count) return false;
+        for (std::uint64_t l = 1; l <= level(v); ++l) {
+            list = upper + upperOffsets[v] + (l - 1)*stride;
+            if (list[0] > stride - 1) return false;
+            for (unsigned i = 1; i <= list[0]; ++i)
+                if (list[i] >= count || level(list[i]) < l) return false;
+        }
+    }
+    return true;
+}
+
+}
+
+// Node IDs are the ones of the Embedding it's built from. The whole index
+// is in a few flat arrays, which save() writes out as they are and load()
+// maps back in without parsing. Only the links are read through once to
+// check them, the vectors are paged in as queries touch them.
+class Hnsw {
+    public:
+        Hnsw() : dims(0), count(0), m(0), maxLevel(0), entry(0), vectors(NULL),
+            upperOffsets(NULL), links0(NULL), upper(NULL), linkLocks(NULL),
+            mapping(NULL), mappingSize(0) {}
+        // Nodes are inserted in parallel, with each link list guarded by one
+        // of a fixed set of locks.
+        explicit Hnsw(const Embedding& e, const HnswOptions& options = HnswOptions());
+        ~Hnsw() { unmap(); }
+
+        Hnsw(const Hnsw&) = delete;
+        Hnsw& operator=(const Hnsw&) = delete;
+
+        unsigned dimensions() const { return dims; }
+        unsigned nodeCount() const { return count; }
+
+        // Up to k nodes most similar to given one, itself excluded, as pairs
+        // of node and cosine similarity, most similar first. Higher ef is
+        // slower and more accurate.
+        std::vector<std::pair<unsigned, float> > nearest(unsigned node, unsigned k, unsigned ef = 64) const;
+        // Same for an arbitrary vector, which doesn't need to be normalized
+        std::vector<std::pair<unsigned, float> > nearest(const float* vector, unsigned k, unsigned ef = 64) const;
+
+        bool save(const std::string& file) const;
+        // Replaces the current contents with a file mapped read-only. Fails
+        // and keeps the current contents if the file is truncated or any
+        // size, offset or link in it is out of range.
+        bool load(const std::string& file);
+
+    private:
+        enum { LockCount = 4096, MaxLevel = 16 };
+
+        unsigned level(unsigned v) const { return (upperOffsets[v + 1] - upperOffsets[v])/(m + 1); }
+        unsigned capacity(unsigned l) const { return l ? m : 2*m; }
+        // first item is the count
+        const unsigned* links(unsigned v, unsigned l) const {
+            return l ? upper + upperOffsets[v] + std::size_t(l - 1)*(m + 1) : links0 + std::size_t(v)*(2*m + 1);
+        }
+        unsigned* mutableLinks(unsigned v, unsigned l) {
+            return l ? ownedUpper.data() + upperOffsets[v] + std::size_t(l - 1)*(m + 1) : ownedLinks0.data() + std::size_t(v)*(2*m + 1);
+        }
+        const float* vector(unsigned v) const { return vectors + std::size_t(v)*dims; }
+        float distance(const float* query, unsigned v) const { return 1.0f - hnsw_detail::Dot(query, vector(v), dims); }
+
+        void copyLinks(unsigned v, unsigned l, std::vector<unsigned>& out) const;
+        unsigned descend(const float* query, unsigned from, unsigned fromLevel, unsigned toLevel) const;
+        void searchLayer(const float* query, unsigned from, unsigned ef, unsigned l, std::vector<hnsw_detail::Candidate>& out) const;
+        void selectNeighbours(std::vector<hnsw_detail::Candidate>& candidates, unsigned max) const;
+        void insert(unsigned v, unsigned efConstruction, std::mutex& entryLock);
+        void unmap();
+
+        unsigned dims;
+        unsigned count;
+        unsigned m;
+        unsigned maxLevel;
+        unsigned entry;
+
+        // point either into the owned vectors below or into the mapping.
+        // Upper layer links of node v start at upperOffsets[v], m + 1 items
+        // per layer.
+        const float* vectors;
+        const std::uint64_t* upperOffsets;
+        const unsigned* links0;
+        const unsigned* upper;
+
+        std::vector<float> ownedVectors;
+        std::vector<std::uint64_t> ownedUpperOffsets;
+        std::vector<unsigned> ownedLinks0;
+        std::vector<unsigned> ownedUpper;
+
+        std::mutex* linkLocks; // only while building
+        void* mapping;
+        std::size_t mappingSize;
+};
+
+inline Hnsw::Hnsw(const Embedding& e, const HnswOptions& options) :
+    dims(e.dimensions), count(e.nodeCount()), m(std::max(options.m, 2u)),
+    maxLevel(0), entry(0), linkLocks(NULL), mapping(NULL), mappingSize(0) {
+    using namespace hnsw_detail;
+
+    const unsigned threads = options.threads ? options.threads : DefaultThreadCount();
+
+    ownedVectors = e.vectors;
+    ParallelFor(count, threads, [this](std::size_t begin, std::size_t end) {
+        for (std::size_t v = begin; v != end; ++v)
+            Normalize(ownedVectors.data() + v*dims, dims);
+    });
+
+    // levels are exponentially distributed, each one m times smaller
+    const double levelScale = 1.0/std::log(double(m));
+    ownedUpperOffsets.resize(std::size_t(count) + 1);
+    for (unsigned v = 0; v != count; ++v) {
+        embedding_detail::Random random(options.seed ^ (std::uint64_t(v)*0x9e3779b97f4a7c15ull));
+        const unsigned l = std::min(unsigned(-std::log(1.0 - random.uniform())*levelScale), unsigned(MaxLevel));
+        ownedUpperOffsets[v + 1] = ownedUpperOffsets[v] + std::uint64_t(l)*(m + 1);
+    }
+    ownedLinks0.assign(std::size_t(count)*(2*m + 1), 0);
+    ownedUpper.assign(ownedUpperOffsets[count], 0);
+
+    vectors = ownedVectors.data();
+    upperOffsets = ownedUpperOffsets.data();
+    links0 = ownedLinks0.data();
+    upper = ownedUpper.data();
+    if (!count) return;
+
+    maxLevel = level(0);
+    std::vector<std::mutex> locks(LockCount);
+    std::mutex entryLock;
+    linkLocks = locks.data();
+    ParallelFor(count - 1, threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            insert(i + 1, options.efConstruction, entryLock);
+    });
+    linkLocks = NULL;
+}
+
+inline void Hnsw::copyLinks(unsigned v, unsigned l, std::vector<unsigned>& out) const {
+    const unsigned* list = links(v, l);
+    if (linkLocks) {
+        std::lock_guard<std::mutex> lock(linkLocks[v % LockCount]);
+        out.assign(list + 1, list + 1 + list[0]);
+    } else out.assign(list + 1, list + 1 + list[0]);
+}
+
+// Greedy walk to the closest node on each layer from fromLevel down to
+// toLevel, which is at least 1
+inline unsigned Hnsw::descend(const float* query, unsigned from, unsigned fromLevel, unsigned toLevel) const {
+    std::vector<unsigned> neighbours;
+    float best = distance(query, from);
+    for (unsigned l = fromLevel; l >= toLevel; --l) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            copyLinks(from, l, neighbours);
+            for (std::size_t i = 0; i != neighbours.size(); ++i) {
+                const float d = distance(query, neighbours[i]);
+                if (d < best) {
+                    best = d;
+                    from = neighbours[i];
+                    changed = true;
+                }
+            }
+        }
+    }
+    return from;
+}
+
+// The ef closest nodes on layer l found by a best-first search from given
+// node, ascending by distance
+inline void Hnsw::searchLayer(const float* query, unsigned from, unsigned ef, unsigned l, std::vector<hnsw_detail::Candidate>& out) const {
+    using namespace hnsw_detail;
+
+    Visited& visited = ThreadVisited();
+    visited.reset(count);
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate> > frontier;
+    std::priority_queue<Candidate> best;
+
+    const Candidate start(distance(query, from), from);
+    visited.visit(from);
+    frontier.push(start);
+    best.push(start);
+
+    std::vector<unsigned> neighbours;
+    while (!frontier.empty()) {
+        const Candidate c = frontier.top();
+        if (c.first > best.top().first) break;
+        frontier.pop();
+        copyLinks(c.second, l, neighbours);
+        for (std::size_t i = 0; i != neighbours.size(); ++i) {
+            const unsigned u = neighbours[i];
+            if (!visited.visit(u)) continue;
+            const float d = distance(query, u);
+            if (best.size() < ef || d < best.top().first) {
+                frontier.push(Candidate(d, u));
+                best.push(Candidate(d, u));
+                if (best.size() > ef) best.pop();
+            }
+        }
+    }
+
+    out.resize(best.size());
+    for (std::size_t i = out.size(); i-- != 0; best.pop()) out[i] = best.top();
+}
+
+// Keeps a candidate only if it's closer to the base than to all already
+// kept ones, which spreads links in different directions instead of into
+// one cluster. Candidates come ascending by distance.
+inline void Hnsw::selectNeighbours(std::vector<hnsw_detail::Candidate>& candidates, unsigned max) const {
+    if (candidates.size() <= max) return;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i != candidates.size() && kept != max; ++i) {
+        bool good = true;
+        for (std::size_t j = 0; j != kept && good; ++j)
+            good = distance(vector(candidates[i].second), candidates[j].second) > candidates[i].first;
+        if (good) candidates[kept++] = candidates[i];
+    }
+    candidates.resize(kept);
+}
+
+inline void Hnsw::insert(unsigned v, unsigned efConstruction, std::mutex& entryLock) {
+    using namespace hnsw_detail;
+
+    // a node going above the current top keeps everyone else out of the
+    // entry point until it's linked in
+    std::unique_lock<std::mutex> lock(entryLock);
+    const unsigned top = maxLevel;
+    const unsigned nodeLevel = level(v);
+    unsigned from = entry;
+    if (nodeLevel <= top) lock.unlock();
+
+    const float* query = vector(v);
+    if (top > nodeLevel) from = descend(query, from, top, nodeLevel + 1);
+
+    std::vector<Candidate> candidates, pruned;
+    for (unsigned l = std::min(nodeLevel, top) + 1; l-- != 0; ) {
+        searchLayer(query, from, efConstruction, l, candidates);
+        from = candidates[0].second;
+        selectNeighbours(candidates, m);
+        {
+            std::lock_guard<std::mutex> linkLock(linkLocks[v % LockCount]);
+            unsigned* list = mutableLinks(v, l);
+            list[0] = candidates.size();
+            for (std::size_t i = 0; i != candidates.size(); ++i) list[i + 1] = candidates[i].second;
+        }
+
+        // back links, pruning full lists with the same heuristic
+        for (std::size_t i = 0; i != candidates.size(); ++i) {
+            const unsigned u = candidates[i].second;
+            std::lock_guard<std::mutex> linkLock(linkLocks[u % LockCount]);
+            unsigned* list = mutableLinks(u, l);
+            if (list[0] < capacity(l)) {
+                list[++list[0]] = v;
+                continue;
+            }
+            pruned.clear();
+            pruned.push_back(Candidate(candidates[i].first, v));
+            for (unsigned j = 1; j <= list[0]; ++j)
+                pruned.push_back(Candidate(distance(vector(u), list[j]), list[j]));
+            std::sort(pruned.begin(), pruned.end());
+            selectNeighbours(pruned, capacity(l));
+            list[0] = pruned.size();
+            for (std::size_t j = 0; j != pruned.size(); ++j) list[j + 1] = pruned[j].second;
+        }
+    }
+
+    if (nodeLevel > top) {
+        maxLevel = nodeLevel;
+        entry = v;
+    }
+}
+
+inline std::vector<std::pair<unsigned, float> > Hnsw::nearest(const float* vector, unsigned k, unsigned ef) const {
+    std::vector<std::pair<unsigned, float> > out;
+    if (!count || !k) return out;
+
+    std::vector<float> query(vector, vector + dims);
+    hnsw_detail::Normalize(query.data(), dims);
+
+    unsigned from = entry;
+    if (maxLevel) from = descend(query.data(), from, maxLevel, 1);
+    std::vector<hnsw_detail::Candidate> candidates;
+    searchLayer(query.data(), from, std::max(ef, k), 0, candidates);
+
+    for (std::size_t i = 0; i != std::min<std::size_t>(k, candidates.size()); ++i)
+        out.push_back(std::make_pair(candidates[i].second, 1.0f - candidates[i].first));
+    return out;
+}
+
+inline std::vector<std::pair<unsigned, float> > Hnsw::nearest(unsigned node, unsigned k, unsigned ef) const {
+    std::vector<std::pair<unsigned, float> > out = nearest(vector(node), k + 1, std::max(ef, k + 1));
+    for (std::size_t i = 0; i != out.size(); ++i) if (out[i].first == node) {
+        out.erase(out.begin() + i);
+        break;
+    }
+    if (out.size() > k) out.resize(k);
+    return out;
+}
+
+// Header, vectors, upper layer offsets aligned to 8 bytes, bottom layer
+// links and upper layer links, all in native byte order
+inline bool Hnsw::save(const std::string& file) const {
+    hnsw_detail::FileHeader header;
+    std::memcpy(header.magic, hnsw_detail::FileMagic, sizeof(header.magic));
+    header.dimensions = dims;
+    header.nodeCount = count;
+    header.m = m;
+    header.maxLevel = maxLevel;
+    header.entryPoint = entry;
+    header.reserved = 0;
+    header.upperSize = count ? upperOffsets[count] : 0;
+
+    std::ofstream output(file, std::ios::binary);
+    if (!output.good()) {
+        std::cerr << "ERROR: failed to open " << file << " for writing" << std::endl;
+        return false;
+    }
+    const std::size_t vectorBytes = std::size_t(count)*dims*sizeof(float);
+    const char padding[8] = {};
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(vectors), vectorBytes);
+    output.write(padding, (8 - vectorBytes % 8) % 8);
+    const std::uint64_t noOffset = 0;
+    output.write(reinterpret_cast<const char*>(count ? upperOffsets : &noOffset), (std::size_t(count) + 1)*sizeof(std::uint64_t));
+    output.write(reinterpret_cast<const char*>(links0), std::size_t(count)*(2*m + 1)*sizeof(unsigned));
+    output.write(reinterpret_cast<const char*>(upper), header.upperSize*sizeof(unsigned));
+    if (!output.good()) {
+        std::cerr << "ERROR: failed to write " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+inline bool Hnsw::load(const std::string& file) {
+    using namespace hnsw_detail;
+
+    const int fd = open(file.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "ERROR: failed to open " << file << std::endl;
+        return false;
+    }
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && std::size_t(info.st_size) >= sizeof(FileHeader))
+        data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "ERROR: failed to map " << file << std::endl;
+        return false;
+    }
+
+    const char* bytes = static_cast<const char*>(data);
+    const std::size_t size = info.st_size;
+    FileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    // m is limited so that 2*m + 1 fits the unsigned math of queries
+    std::uint64_t vectorBytes, links0Start, upperStart, end;
+    bool valid = std::memcmp(header.magic, FileMagic, sizeof(header.magic)) == 0 &&
+        header.m >= 2 && header.m <= std::numeric_limits<unsigned>::max()/2 - 1 &&
+        MultiplyAdd(std::uint64_t(header.nodeCount)*header.dimensions, sizeof(float), 0, vectorBytes) &&
+        vectorBytes <= size;
+    const std::uint64_t offsetsStart = valid ? sizeof(header) + vectorBytes + (8 - vectorBytes % 8) % 8 : 0;
+    valid = valid &&
+        MultiplyAdd(std::uint64_t(header.nodeCount) + 1, sizeof(std::uint64_t), offsetsStart, links0Start) &&
+        MultiplyAdd(std::uint64_t(header.nodeCount)*(2*std::uint64_t(header.m) + 1), sizeof(unsigned), links0Start, upperStart) &&
+        MultiplyAdd(header.upperSize, sizeof(unsigned), upperStart, end) &&
+        size == end &&
+        ValidLinks(header, reinterpret_cast<const std::uint64_t*>(bytes + offsetsStart),
+            reinterpret_cast<const unsigned*>(bytes + links0Start),
+            reinterpret_cast<const unsigned*>(bytes + upperStart));
+    if (!valid) {
+        std::cerr << "ERROR: " << file << " is not a valid index" << std::endl;
+        munmap(data, size);
+        return false;
+    }
+
+    unmap();
+    ownedVectors = std::vector<float>();
+    ownedUpperOffsets = std::vector<std::uint64_t>();
+    ownedLinks0 = std::vector<unsigned>();
+    ownedUpper = std::vector<unsigned>();
+    mapping = data;
+    mappingSize = size;
+
+    dims = header.dimensions;
+    count = header.nodeCount;
+    m = header.m;
+    maxLevel = header.maxLevel;
+    entry = header.entryPoint;
+    vectors = reinterpret_cast<const float*>(bytes + sizeof(header));
+    upperOffsets = reinterpret_cast<const std::uint64_t*>(bytes + offsetsStart);
+    links0 = reinterpret_cast<const unsigned*>(bytes + links0Start);
+    upper = reinterpret_cast<const unsigned*>(bytes + upperStart);
+    return true;
+}
+
+inline void Hnsw::unmap() {
+    if (mapping) munmap(mapping, mappingSize);
+    mapping = NULL;
+    mappingSize = 0;
+}
+
+#endif
@@ -3,39 +3,85 @@
 #include <string>
 #include <list>
 #include "wgraph.h"
-
-void ReadFile(std::string file, Wgraph& w) {
-
-    std::ifstream input(file);
-    if (!input.good()) {
-        std::cerr << "ERROR: failed to open input file" << std::endl;
-        exit(1);
-    }
-    std::string prev = "false";
-    std::string buffer;
-    while(input >> buffer) {
-        std::string buffer2;
-        input >> buffer2;
-        w.add(buffer,buffer2,100);
-        if (prev != "false") 
-            w.connect(buffer,prev);
-        prev = buffer;
-    }
-
-    input.close();
-}
+#include "readfile.h"
+#include "components.h"
+#include "cores.h"
+#include "embedding.h"
+#include "hnsw.h"
+#include "compressed.h"
+#include "query.h"
 
 int main(int argc, char * argv[]) {
 
-    if (argc != 2) {
+    // --related as the last input also trains node embeddings and prints
+    // related pages, which takes a while on a big history
+    bool related = false;
+    if (argc > 2 && std::string(argv[argc - 1]) == "--related") {
+        related = true;
+        --argc;
+    }
+    if (argc != 2 && argc != 3) {
         std::cerr << "ERROR: wrong number of inputs detected." << std::endl;
         exit(1);
     }
-    // argv[2] == input file for testing purposes.
+    // argv[1] == input file for testing purposes, argv[2] an optional query.
     Wgraph test1 = Wgraph();
-    ReadFile(std::string(argv[1]), test1);
+    Sessions sessions;
+    ReadFile(std::string(argv[1]), test1, &sessions);
     test1.print();
     test1.printConnect();
 
+    for (unsigned i = 0; i != sessions.count(); ++i) {
+        std::cout << "session " << i << ":";
+        for (unsigned j = 0; j != sessions[i].visits.size(); ++j)
+            std::cout << " " << sessions.tag(sessions[i].visits[j]);
+        std::cout << std::endl;
+    }
+
+    Components components = ConnectedComponents(test1);
+    std::cout << components.count() << " components, " << components.isolated.size() << " isolated:";
+    std::vector<std::string> tags;
+    for (std::map<std::string,Node*>::const_iterator itr = test1.nodes().begin(); itr != test1.nodes().end(); itr++)
+        tags.push_back(itr->first);
+    for (unsigned i = 0; i != components.isolated.size(); ++i)
+        std::cout << " " << tags[components.isolated[i]];
+    std::cout << std::endl;
+
+    Adjacency adjacency = BuildAdjacency(test1);
+    Cores cores = CoreDecomposition(adjacency);
+    DenseSubgraph densest = DensestSubgraph(adjacency, cores);
+    std::cout << "degeneracy " << cores.degeneracy << ", densest subgraph of " << densest.nodes.size()
+              << " nodes with " << densest.density << " edges per node:";
+    for (unsigned i = 0; i != densest.nodes.size(); ++i)
+        std::cout << " " << tags[densest.nodes[i]];
+    std::cout << std::endl;
+
+    CompressedAdjacency compressed = CompressAdjacency(adjacency);
+    std::cout << "adjacency compressed to " << compressed.memoryBytes() << " bytes from "
+              << (adjacency.offsets.size()*sizeof(std::size_t) + adjacency.neighbours.size()*2*sizeof(unsigned)) << std::endl;
 
+    if (related) {
+        Embedding embedding = TrainEmbedding(adjacency);
+        Hnsw index(embedding);
+        for (unsigned i = 0; i != index.nodeCount(); ++i) {
+            std::vector<std::pair<unsigned, float> > nearest = index.nearest(i, 3);
+            std::cout << "related to " << tags[i] << ":";
+            for (unsigned j = 0; j != nearest.size(); ++j)
+                std::cout << " " << tags[nearest[j].first];
+            std::cout << std::endl;
+        }
+    }
+
+    if (argc == 3) {
+        QueryGraph graph = BuildQueryGraph(test1, &sessions);
+        QueryPlan plan;
+        std::string error;
+        if (!CompileQuery(argv[2], graph, plan, error)) {
+            std::cerr << "ERROR: " << error << std::endl;
+            exit(1);
+        }
+        QuerySelection result = RunQuery(plan, graph);
+        for (unsigned i = 0; i != result.ids.size(); ++i)
+            std::cout << graph.tags[result.ids[i]] << " " << graph.links[result.ids[i]] << " " << result.weights[i] << std::endl;
+    }
 }
\ No newline at end of file
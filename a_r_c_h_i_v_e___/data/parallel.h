@@ -0,0 +1,26 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Thread count to use when the caller passes 0
+inline unsigned DefaultThreadCount() {
+    const unsigned count = std::thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+// Runs f(begin, end) over [0, count) split into one chunk per thread
+template<class F> inline void ParallelFor(std::size_t count, unsigned threads, F f) {
+    if (threads <= 1 || count < 2*threads) {
+        f(std::size_t(0), count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t != threads; ++t)
+        workers.emplace_back(f, count*t/threads, count*(t + 1)/threads);
+    for (std::thread& worker : workers) worker.join();
+}
+
+#endif
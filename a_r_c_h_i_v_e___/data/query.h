@@ -0,0 +1,382 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "adjacency.h"
+#include "sessions.h"
+#include "wgraph.h"
+
+// Column snapshot of a Wgraph that queries run against. Node IDs are the
+// same as in Adjacency. Without sessions, visits are approximated by how
+// many links a node has and the last visit time is unknown.
+struct QueryGraph {
+    Adjacency adjacency;
+    std::vector<std::string> tags;
+    std::vector<std::string> links;
+    std::vector<std::string> domains;
+    std::vector<unsigned> domain;      // index into domains of each node
+    std::vector<unsigned> visits;
+    std::vector<long long> lastVisit;  // Sessions::NoTime if unknown
+    std::unordered_map<std::string, unsigned> tagIds;
+    std::unordered_map<std::string, unsigned> domainIds;
+
+    unsigned nodeCount() const { return tags.size(); }
+};
+
+// host part of a link, without the scheme, port, path, query and fragment
+inline std::string LinkDomain(const std::string& link) {
+    std::size_t begin = link.find("://");
+    begin = begin == std::string::npos ? 0 : begin + 3;
+    const std::size_t end = link.find_first_of("/?#:", begin);
+    return link.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+inline QueryGraph BuildQueryGraph(const Wgraph& w, const Sessions* sessions = NULL) {
+    QueryGraph g;
+    g.adjacency = BuildAdjacency(w);
+    const std::map<std::string,Node*>& nodes = w.nodes();
+    for (std::map<std::string,Node*>::const_iterator itr = nodes.begin(); itr != nodes.end(); itr++) {
+        const unsigned id = g.tags.size();
+        g.tagIds.insert(std::make_pair(itr->first, id));
+        g.tags.push_back(itr->first);
+        g.links.push_back(itr->second->link);
+        const std::string d = LinkDomain(itr->second->link);
+        std::unordered_map<std::string, unsigned>::const_iterator found = g.domainIds.find(d);
+        if (found == g.domainIds.end()) {
+            found = g.domainIds.insert(std::make_pair(d, unsigned(g.domains.size()))).first;
+            g.domains.push_back(d);
+        }
+        g.domain.push_back(found->second);
+    }
+
+    const unsigned n = g.nodeCount();
+    g.visits.assign(n, 0);
+    // a copy, as assign() taking it by reference would need a definition
+    // of the constant outside of the class
+    const long long noTime = Sessions::NoTime;
+    g.lastVisit.assign(n, noTime);
+    if (sessions) {
+        for (unsigned s = 0; s != sessions->count(); ++s) {
+            const Session& session = (*sessions)[s];
+            for (std::size_t i = 0; i != session.visits.size(); ++i) {
+                std::unordered_map<std::string, unsigned>::const_iterator found = g.tagIds.find(sessions->tag(session.visits[i]));
+                if (found == g.tagIds.end()) continue;
+                ++g.visits[found->second];
+                g.lastVisit[found->second] = std::max(g.lastVisit[found->second], session.times[i]);
+            }
+        }
+    } else for (unsigned v = 0; v != n; ++v)
+        for (std::size_t i = g.adjacency.offsets[v]; i != g.adjacency.offsets[v + 1]; ++i)
+            g.visits[v] += g.adjacency.weights[i];
+    return g;
+}
+
+// Queries are stages separated by "|", starting with a scan:
+//
+//   all | tag <tag> | domain <domain>
+//
+// followed by any of
+//
+//   where <field> <op> <value>    field is visits, degree, last, weight or
+//                                 domain, op one of = != < <= > >=
+//   after <time>, before <time>   same as where last > time, last < time
+//   expand <hops>                 nodes within that many hops, without the
+//                                 ones already there
+//   top <count> [by <field>]      highest first, by weight if not given
+//
+// e.g. "domain example.com | expand 2 | after 1700000000 | top 10". The
+// weight of a scanned node is 1, expanding gives each new node the sum of
+// weights of its edges to nodes reached before it.
+enum QueryField { FieldVisits, FieldDegree, FieldLast, FieldWeight, FieldDomain };
+enum QueryCompare { CompareEqual, CompareNotEqual, CompareLess, CompareLessEqual, CompareGreater, CompareGreaterEqual };
+
+struct QueryOp {
+    enum Kind { ScanAll, ScanTag, ScanDomain, Filter, Expand, Top };
+
+    Kind kind;
+    QueryField field;
+    QueryCompare compare;
+    double value;    // compared against, or the domain ID for domains
+    unsigned id;     // node or domain ID for scans, ~0u if there's none
+    unsigned count;  // hops or top count
+};
+
+struct QueryPlan {
+    std::vector<QueryOp> ops;
+};
+
+// IDs with the weight of each, the result of every stage
+struct QuerySelection {
+    std::vector<unsigned> ids;
+    std::vector<double> weights;
+};
+
+namespace query_detail {
+
+// Filters work on this many IDs at a time, with the field gathered into a
+// buffer first so the comparison is a tight loop over it
+const std::size_t BatchSize = 1024;
+
+inline bool ParseField(const std::string& word, QueryField& field) {
+    if (word == "visits") field = FieldVisits;
+    else if (word == "degree") field = FieldDegree;
+    else if (word == "last") field = FieldLast;
+    else if (word == "weight") field = FieldWeight;
+    else if (word == "domain") field = FieldDomain;
+    else return false;
+    return true;
+}
+
+inline bool ParseCompare(const std::string& word, QueryCompare& compare) {
+    if (word == "=") compare = CompareEqual;
+    else if (word == "!=") compare = CompareNotEqual;
+    else if (word == "<") compare = CompareLess;
+    else if (word == "<=") compare = CompareLessEqual;
+    else if (word == ">") compare = CompareGreater;
+    else if (word == ">=") compare = CompareGreaterEqual;
+    else return false;
+    return true;
+}
+
+inline bool ParseNumber(const std::string& word, double& value) {
+    char* end;
+    value = std::strtod(word.c_str(), &end);
+    return !word.empty() && *end == '\0';
+}
+
+inline double FieldValue(const QueryGraph& g, QueryField field, unsigned id, double weight) {
+    switch (field) {
+        case FieldVisits: return g.visits[id];
+        case FieldDegree: return g.adjacency.degree(id);
+        case FieldLast: return double(g.lastVisit[id]);
+        case FieldWeight: return weight;
+        case FieldDomain: return g.domain[id];
+    }
+    return 0.0;
+}
+
+template<class Compare> inline std::size_t Select(const double* values, std::size_t count, double value, unsigned* keep, Compare compare) {
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i != count; ++i) {
+        keep[kept] = i;
+        kept += compare(values[i], value);
+    }
+    return kept;
+}
+
+inline void RunFilter(const QueryGraph& g, const QueryOp& op, QuerySelection& s) {
+    double values[BatchSize];
+    unsigned keep[BatchSize];
+    std::size_t out = 0;
+    for (std::size_t begin = 0; begin < s.ids.size(); begin += BatchSize) {
+        const std::size_t count = std::min(BatchSize, s.ids.size() - begin);
+        for (std::size_t i = 0; i != count; ++i)
+            values[i] = FieldValue(g, op.field, s.ids[begin + i], s.weights[begin + i]);
+        // unknown times never pass
+        if (op.field == FieldLast)
+            for (std::size_t i = 0; i != count; ++i)
+                if (g.lastVisit[s.ids[begin + i]] == Sessions::NoTime) values[i] = op.compare == CompareNotEqual ? op.value : std::numeric_limits<double>::quiet_NaN();
+
+        std::size_t kept = 0;
+        switch (op.compare) {
+            case CompareEqual: kept = Select(values, count, op.value, keep, [](double a, double b) { return a == b; }); break;
+            case CompareNotEqual: kept = Select(values, count, op.value, keep, [](double a, double b) { return a != b; }); break;
+            case CompareLess: kept = Select(values, count, op.value, keep, [](double a, double b) { return a < b; }); break;
+            case CompareLessEqual: kept = Select(values, count, op.value, keep, [](double a, double b) { return a <= b; }); break;
+            case CompareGreater: kept = Select(values, count, op.value, keep, [](double a, double b) { return a > b; }); break;
+            case CompareGreaterEqual: kept = Select(values, count, op.value, keep, [](double a, double b) { return a >= b; }); break;
+        }
+        // compacting in place, out never overtakes begin
+        for (std::size_t i = 0; i != kept; ++i) {
+            s.ids[out] = s.ids[begin + keep[i]];
+            s.weights[out++] = s.weights[begin + keep[i]];
+        }
+    }
+    s.ids.resize(out);
+    s.weights.resize(out);
+}
+
+inline void RunExpand(const QueryGraph& g, const QueryOp& op, QuerySelection& s) {
+    const Adjacency& a = g.adjacency;
+    // level each node was reached at, 0 for the ones already selected
+    const unsigned Unreached = ~0u;
+    std::vector<unsigned> level(g.nodeCount(), Unreached);
+    std::vector<double> weight(g.nodeCount(), 0.0);
+    for (std::size_t i = 0; i != s.ids.size(); ++i) level[s.ids[i]] = 0;
+
+    std::vector<unsigned> frontier(s.ids), next;
+    QuerySelection out;
+    for (unsigned hop = 1; hop <= op.count && !frontier.empty(); ++hop) {
+        next.clear();
+        for (std::size_t i = 0; i != frontier.size(); ++i) {
+            const unsigned v = frontier[i];
+            for (std::size_t e = a.offsets[v]; e != a.offsets[v + 1]; ++e) {
+                const unsigned u = a.neighbours[e];
+                if (level[u] == Unreached) {
+                    level[u] = hop;
+                    next.push_back(u);
+                }
+                if (level[u] == hop) weight[u] += a.weights[e];
+            }
+        }
+        for (std::size_t i = 0; i != next.size(); ++i) {
+            out.ids.push_back(next[i]);
+            out.weights.push_back(weight[next[i]]);
+        }
+        std::swap(frontier, next);
+    }
+    std::swap(s, out);
+}
+
+inline void RunTop(const QueryGraph& g, const QueryOp& op, QuerySelection& s) {
+    std::vector<std::pair<double, unsigned> > ranked(s.ids.size());
+    for (std::size_t i = 0; i != s.ids.size(); ++i)
+        ranked[i] = std::make_pair(FieldValue(g, op.field, s.ids[i], s.weights[i]), unsigned(i));
+    const std::size_t kept = std::min<std::size_t>(op.count, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + kept, ranked.end(),
+        [&s](const std::pair<double, unsigned>& a, const std::pair<double, unsigned>& b) {
+            return a.first != b.first ? a.first > b.first : s.ids[a.second] < s.ids[b.second];
+        });
+    QuerySelection out;
+    for (std::size_t i = 0; i != kept; ++i) {
+        out.ids.push_back(s.ids[ranked[i].second]);
+        out.weights.push_back(s.weights[ranked[i].second]);
+    }
+    std::swap(s, out);
+}
+
+}
+
+// Parses a query and resolves names in it against the graph, a tag or
+// domain that isn't there just scans nothing. Returns false with a message
+// in error if the query is malformed.
+inline bool CompileQuery(const std::string& text, const QueryGraph& g, QueryPlan& plan, std::string& error) {
+    using namespace query_detail;
+    plan.ops.clear();
+
+    std::istringstream stages(text);
+    std::string stage;
+    while (std::getline(stages, stage, '|')) {
+        std::istringstream input(stage);
+        std::vector<std::string> words;
+        std::string word;
+        while (input >> word) words.push_back(word);
+        if (words.empty()) {
+            error = "empty stage";
+            return false;
+        }
+
+        QueryOp op = QueryOp();
+        op.field = FieldWeight;
+        op.id = ~0u;
+        const std::string& name = words[0];
+        const bool scan = name == "all" || name == "tag" || name == "domain";
+        if (scan != plan.ops.empty()) {
+            error = scan ? "a scan can be only the first stage" : "a query has to start with all, tag or domain";
+            return false;
+        }
+
+        if (name == "all" && words.size() == 1) {
+            op.kind = QueryOp::ScanAll;
+        } else if ((name == "tag" || name == "domain") && words.size() == 2) {
+            op.kind = name == "tag" ? QueryOp::ScanTag : QueryOp::ScanDomain;
+            const std::unordered_map<std::string, unsigned>& ids = name == "tag" ? g.tagIds : g.domainIds;
+            std::unordered_map<std::string, unsigned>::const_iterator found = ids.find(words[1]);
+            if (found != ids.end()) op.id = found->second;
+        } else if (name == "where" && words.size() == 4) {
+            op.kind = QueryOp::Filter;
+            if (!ParseField(words[1], op.field) || !ParseCompare(words[2], op.compare)) {
+                error = "bad field or comparison in \"" + stage + "\"";
+                return false;
+            }
+            if (op.field == FieldDomain) {
+                if (op.compare != CompareEqual && op.compare != CompareNotEqual) {
+                    error = "domains can only be compared with = and !=";
+                    return false;
+                }
+                std::unordered_map<std::string, unsigned>::const_iterator found = g.domainIds.find(words[3]);
+                // matches no node
+                op.value = found == g.domainIds.end() ? -1.0 : found->second;
+            } else if (!ParseNumber(words[3], op.value)) {
+                error = "bad number in \"" + stage + "\"";
+                return false;
+            }
+        } else if ((name == "after" || name == "before") && words.size() == 2) {
+            op.kind = QueryOp::Filter;
+            op.field = FieldLast;
+            op.compare = name == "after" ? CompareGreater : CompareLess;
+            if (!ParseNumber(words[1], op.value)) {
+                error = "bad time in \"" + stage + "\"";
+                return false;
+            }
+        } else if ((name == "expand" && words.size() == 2) ||
+                   (name == "top" && (words.size() == 2 || (words.size() == 4 && words[2] == "by")))) {
+            op.kind = name == "expand" ? QueryOp::Expand : QueryOp::Top;
+            double count;
+            // checked for the range first, casting anything outside of it is
+            // undefined, and NaN fails every comparison
+            if (!ParseNumber(words[1], count) || !(count >= 0 && count <= std::numeric_limits<unsigned>::max()) || count != std::floor(count)) {
+                error = "bad count in \"" + stage + "\"";
+                return false;
+            }
+            op.count = count;
+            if (words.size() == 4 && !ParseField(words[3], op.field)) {
+                error = "bad field in \"" + stage + "\"";
+                return false;
+            }
+        } else {
+            error = "can't parse \"" + stage + "\"";
+            return false;
+        }
+        plan.ops.push_back(op);
+    }
+    if (plan.ops.empty()) {
+        error = "empty query";
+        return false;
+    }
+    return true;
+}
+
+inline QuerySelection RunQuery(const QueryPlan& plan, const QueryGraph& g) {
+    using namespace query_detail;
+
+    QuerySelection s;
+    for (std::size_t i = 0; i != plan.ops.size(); ++i) {
+        const QueryOp& op = plan.ops[i];
+        switch (op.kind) {
+            case QueryOp::ScanAll:
+                s.ids.resize(g.nodeCount());
+                for (unsigned v = 0; v != g.nodeCount(); ++v) s.ids[v] = v;
+                break;
+            case QueryOp::ScanTag:
+                if (op.id != ~0u) s.ids.push_back(op.id);
+                break;
+            case QueryOp::ScanDomain:
+                for (unsigned v = 0; v != g.nodeCount(); ++v)
+                    if (g.domain[v] == op.id) s.ids.push_back(v);
+                break;
+            case QueryOp::Filter:
+                RunFilter(g, op, s);
+                break;
+            case QueryOp::Expand:
+                RunExpand(g, op, s);
+                break;
+            case QueryOp::Top:
+                RunTop(g, op, s);
+                break;
+        }
+        if (i == 0) s.weights.assign(s.ids.size(), 1.0);
+    }
+    return s;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef READFILE_H
+#define READFILE_H
+
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include "retention.h"
+#include "sessions.h"
+#include "wgraph.h"
+
+// reads one visit per line, "tag link", optionally followed by the visit
+// time in seconds, the tab and the referring tag, "-" for none of the
+// latter two. Each visit is linked to the one before it in the same
+// browsing session, see Sessions. Lines without a time all end up in one
+// session per tab. The sessions are recorded if given, and visits are fed
+// to the retention policy if given, by line number for lines without a
+// time. Without sessions given, the ones kept for linking hold only the
+// open sessions when there's a retention policy, so memory stays bounded.
+// The observer, if any, sees every visit as "tag, link, time", with
+// Sessions::NoTime for lines without one.
+typedef std::function<void(const std::string&, const std::string&, long long)> VisitObserver;
+inline void ReadVisits(std::istream& input, Wgraph& w, Sessions* sessions = NULL, Retention* retention = NULL, const VisitObserver& observer = VisitObserver()) {
+
+    SessionOptions options;
+    options.keepClosed = !retention;
+    Sessions local(options);
+    if (!sessions) sessions = &local;
+    std::string line;
+    long long lineNumber = 0;
+    while(std::getline(input, line)) {
+        ++lineNumber;
+        std::istringstream fields(line);
+        std::string buffer, buffer2, tab, referrer;
+        if (!(fields >> buffer >> buffer2)) continue;
+        long long time = Sessions::NoTime;
+        if (!(fields >> time)) time = Sessions::NoTime;
+        fields >> tab >> referrer;
+        if (tab == "-") tab.clear();
+        if (referrer == "-") referrer.clear();
+
+        w.add(buffer,buffer2,100);
+        std::string prev;
+        // the previous page may have been evicted since
+        const bool linked = sessions->visit(buffer, time, tab, referrer, prev) && w.find(prev);
+        if (linked)
+            w.connect(buffer,prev);
+        if (retention)
+            retention->visited(buffer, time == Sessions::NoTime ? lineNumber : time, linked, sessions);
+        if (observer)
+            observer(buffer, buffer2, time);
+    }
+}
+
+// same from a file, exits if it can't be opened
+inline void ReadFile(std::string file, Wgraph& w, Sessions* sessions = NULL, Retention* retention = NULL, const VisitObserver& observer = VisitObserver()) {
+
+    std::ifstream input(file);
+    if (!input.good()) {
+        std::cerr << "ERROR: failed to open input file" << std::endl;
+        exit(1);
+    }
+    ReadVisits(input, w, sessions, retention, observer);
+    input.close();
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "sessions.h"
+#include "wgraph.h"
+
+// Keeps a Wgraph within a memory budget by evicting the nodes least worth
+// keeping, optionally appending them to an archive file first. The worth
+// of a node is the sum of its visits, each one decaying by half every
+// halfLife, so it accounts for both how recent and how frequent they were.
+struct RetentionOptions {
+    RetentionOptions(): budget(std::size_t(1) << 30), lowWater(0.9), halfLife(30.0*24*60*60) {}
+
+    std::size_t budget;  // estimated bytes the graph may take
+    double lowWater;     // evicts down to this fraction of the budget
+    double halfLife;     // in the units of the visit times, seconds in ReadFile
+    std::string archive; // file evicted nodes are appended to, none if empty
+};
+
+class Retention {
+    public:
+        // Rough heap cost of a node with its map entry and bookkeeping here,
+        // not counting the strings, and of one end of an edge, an adj and a
+        // twins entry
+        static const std::size_t NodeBytes = 320;
+        static const std::size_t EdgeBytes = 80;
+
+        Retention(Wgraph& w, const RetentionOptions& o = RetentionOptions()) : graph(w), options(o), bytes(0), sessionBytes(0), evicted(0), origin(0), started(false) {}
+
+        // of the graph, and of the sessions as of the last visit
+        std::size_t memoryBytes() const { return bytes + sessionBytes; }
+        std::size_t evictedCount() const { return evicted; }
+
+        // Records a visit to a node already added to the graph and, if it was
+        // linked by it, the two list entries connect() made. Evicts once
+        // over the budget, which may remove any node but this one. Sessions
+        // the visits are split into, if given, count towards the budget and
+        // forget the evicted pages.
+        void visited(const std::string& tag, double time, bool linked, Sessions* sessions = NULL) {
+            if (!started) {
+                origin = time;
+                started = true;
+            }
+            // decay is the same for all nodes, so instead of decaying every
+            // score, later visits weigh exponentially more. Kept as a
+            // logarithm so it doesn't overflow.
+            const double weight = (time - origin)*std::log(2.0)/options.halfLife;
+
+            std::unordered_map<std::string, double>::iterator itr = scores.find(tag);
+            if (itr == scores.end()) {
+                const Node* n = graph.find(tag);
+                bytes += NodeBytes + 2*tag.capacity() + n->link.capacity();
+                itr = scores.insert(std::make_pair(tag, weight)).first;
+            } else {
+                ranking.erase(std::make_pair(itr->second, tag));
+                const double high = std::max(itr->second, weight), low = std::min(itr->second, weight);
+                itr->second = high + std::log1p(std::exp(low - high));
+            }
+            ranking.insert(std::make_pair(itr->second, tag));
+            if (linked) bytes += 2*EdgeBytes;
+
+            if (sessions) sessionBytes = sessions->memoryBytes();
+            if (bytes + sessionBytes > options.budget) evict(tag, sessions);
+        }
+
+    private:
+        void evict(const std::string& keep, Sessions* sessions) {
+            const std::size_t target = options.budget*options.lowWater;
+            std::ofstream archive;
+            if (!options.archive.empty()) {
+                archive.open(options.archive, std::ios::app);
+                if (!archive.good())
+                    std::cerr << "ERROR: failed to open archive " << options.archive << std::endl;
+            }
+
+            std::set<std::pair<double, std::string> >::iterator itr = ranking.begin();
+            while (bytes + sessionBytes > target && itr != ranking.end()) {
+                if (itr->second == keep) {
+                    ++itr;
+                    continue;
+                }
+                const std::string tag = itr->second;
+                const Node* n = graph.find(tag);
+                // "tag link neighbour...", a neighbour per visit between them
+                if (archive.is_open()) {
+                    archive << tag << " " << n->link;
+                    for (std::list<Node*>::const_iterator itr2 = n->adj.begin(); itr2 != n->adj.end(); itr2++)
+                        archive << " " << (*itr2)->tag;
+                    archive << "\n";
+                }
+                const std::size_t freed = NodeBytes + 2*tag.capacity() + n->link.capacity() + 2*n->adj.size()*EdgeBytes;
+                bytes -= std::min(bytes, freed);
+                graph.remove(tag);
+                if (sessions) {
+                    sessions->forget(tag);
+                    sessionBytes = sessions->memoryBytes();
+                }
+                scores.erase(tag);
+                ranking.erase(itr++);
+                ++evicted;
+            }
+        }
+
+        Wgraph& graph;
+        RetentionOptions options;
+        std::size_t bytes;
+        std::size_t sessionBytes;
+        std::size_t evicted;
+        double origin;
+        bool started;
+        std::unordered_map<std::string, double> scores;     // log of the undecayed score
+        std::set<std::pair<double, std::string> > ranking;  // lowest score first
+};
+
+#endif
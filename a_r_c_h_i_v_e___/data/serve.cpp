@@ -0,0 +1,46 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <thread>
+#include <sys/stat.h>
+#include "wgraph.h"
+#include "readfile.h"
+#include "server.h"
+
+// Serves the graph of an input file on localhost, see GraphServer, and
+// serves it again whenever the file changes.
+int main(int argc, char * argv[]) {
+
+    if (argc != 2 && argc != 3) {
+        std::cerr << "ERROR: usage: serve <input file> [port]" << std::endl;
+        exit(1);
+    }
+    ServerOptions options;
+    if (argc == 3) options.port = std::atoi(argv[2]);
+
+    GraphServer server(options);
+    time_t modified = 0;
+    for (;;) {
+        struct stat status;
+        if (stat(argv[1], &status) == 0 && status.st_mtime != modified) {
+            modified = status.st_mtime;
+            // the file may be gone again by now, the previous graph stays
+            // served until it can be read
+            std::ifstream input(argv[1]);
+            if (input.good()) {
+                Wgraph graph;
+                Sessions sessions;
+                ReadVisits(input, graph, &sessions);
+                server.update(graph, &sessions);
+                std::cout << "serving " << graph.nodes().size() << " nodes on port " << options.port << std::endl;
+            } else {
+                std::cerr << "ERROR: failed to open input file " << argv[1] << std::endl;
+                modified = 0;
+            }
+        }
+        if (!server.start()) exit(1);
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+    }
+}
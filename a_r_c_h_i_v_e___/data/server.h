@@ -0,0 +1,612 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "components.h"
+#include "parallel.h"
+#include "query.h"
+#include "sessions.h"
+#include "wgraph.h"
+
+// Serves a snapshot of a Wgraph as JSON over HTTP on localhost, so a page
+// can fetch just the part of the graph it shows:
+//
+//   /subgraph?node=<tag>[&hops=2][&limit=200]  nodes within hops of one,
+//                                             nearest first, and the links
+//                                             between them
+//   /search?q=<text>[&limit=20]               nodes with text in the tag or
+//                                             link
+//   /path?from=<tag>&to=<tag>                 tags on a shortest path, empty
+//                                             if there's none
+//   /clusters[?limit=20]                      largest connected components
+//                                             with their best linked node
+//   /query?q=<query>[&limit=200]              see CompileQuery(), with the
+//                                             count of all results
+//
+// Nodes are {"id", "link", "visits"} and links {"source", "target",
+// "weight"}, by tag. Requests need a Host of 127.0.0.1 or localhost with
+// the port, so a page elsewhere can't reach the server by rebinding its
+// DNS name to the loopback address. There are no CORS headers, as the
+// extension reaches it through its host permissions and nothing else
+// should. Every thread of the pool waits on the same epoll
+// instance, each connection being armed for one of them at a time, and
+// connections are kept alive unless the client says otherwise. Responses
+// are cached per request until update() replaces the snapshot.
+struct ServerOptions {
+    ServerOptions(): port(8080), threads(0), cacheSize(4096) {}
+
+    unsigned short port;  // on 127.0.0.1
+    unsigned threads;     // 0 for DefaultThreadCount()
+    std::size_t cacheSize; // responses kept before the cache starts over
+};
+
+namespace server_detail {
+
+// Largest request head accepted, anything bigger gets the connection closed
+const std::size_t MaxRequestBytes = 16384;
+// Pipelined input read ahead of the request being answered. The rest waits
+// in the socket until there's room.
+const std::size_t MaxInputBytes = 4*MaxRequestBytes;
+
+inline void JsonString(std::string& out, const std::string& s) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (std::size_t i = 0; i != s.size(); ++i) {
+        const unsigned char c = s[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        } else out += c;
+    }
+    out += '"';
+}
+
+inline std::string UrlDecode(const std::string& s) {
+    std::string out;
+    for (std::size_t i = 0; i != s.size(); ++i) {
+        if (s[i] == '+') out += ' ';
+        else if (s[i] == '%' && i + 2 < s.size() && std::isxdigit(s[i + 1]) && std::isxdigit(s[i + 2])) {
+            out += char(std::strtol(s.substr(i + 1, 2).c_str(), NULL, 16));
+            i += 2;
+        } else out += s[i];
+    }
+    return out;
+}
+
+// "/path?a=1&b=2" split to the path and decoded parameters
+inline std::string ParseTarget(const std::string& target, std::unordered_map<std::string, std::string>& parameters) {
+    const std::size_t question = target.find('?');
+    std::istringstream input(question == std::string::npos ? std::string() : target.substr(question + 1));
+    std::string pair;
+    while (std::getline(input, pair, '&')) {
+        const std::size_t equals = pair.find('=');
+        if (equals == std::string::npos) parameters[UrlDecode(pair)] = std::string();
+        else parameters[UrlDecode(pair.substr(0, equals))] = UrlDecode(pair.substr(equals + 1));
+    }
+    return target.substr(0, question);
+}
+
+inline bool ParseCount(const std::unordered_map<std::string, std::string>& parameters, const char* name, unsigned& value) {
+    std::unordered_map<std::string, std::string>::const_iterator found = parameters.find(name);
+    if (found == parameters.end()) return true;
+    char* end;
+    const unsigned long parsed = std::strtoul(found->second.c_str(), &end, 10);
+    if (found->second.empty() || *end != '\0' || parsed > 1000000) return false;
+    value = parsed;
+    return true;
+}
+
+// Graph a response is made from, replaced as a whole by update()
+struct Snapshot {
+    QueryGraph graph;
+    Components components;
+    std::vector<unsigned> hubs; // highest degree node of each component
+    unsigned long long version;
+};
+
+struct Response {
+    int status;
+    std::shared_ptr<const std::string> body;
+};
+
+struct Connection {
+    Connection(int f) : fd(f), sent(0), close(false) {}
+
+    int fd;
+    std::string input;
+    // response being written, the head followed by the body
+    std::string head;
+    std::shared_ptr<const std::string> body;
+    std::size_t sent;
+    bool close;
+};
+
+// with the weight a query gave it, if any
+inline void NodeJson(std::string& out, const QueryGraph& g, unsigned v, const double* weight = NULL) {
+    out += "{\"id\":";
+    JsonString(out, g.tags[v]);
+    out += ",\"link\":";
+    JsonString(out, g.links[v]);
+    out += ",\"visits\":" + std::to_string(g.visits[v]);
+    if (weight) {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.10g", *weight);
+        out += ",\"weight\":";
+        out += number;
+    }
+    out += '}';
+}
+
+inline void NodesJson(std::string& out, const QueryGraph& g, const std::vector<unsigned>& nodes) {
+    out += "\"nodes\":[";
+    for (std::size_t i = 0; i != nodes.size(); ++i) {
+        if (i) out += ',';
+        NodeJson(out, g, nodes[i]);
+    }
+    out += ']';
+}
+
+inline const char* StatusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+    }
+    return "Internal Server Error";
+}
+
+}
+
+class GraphServer {
+    public:
+        GraphServer(const ServerOptions& o = ServerOptions()) : options(o), listener(-1), epoll(-1), wakeup(-1), cacheVersion(0) {}
+        ~GraphServer() { stop(); }
+
+        // Replaces the graph served, safe to call while serving. Requests
+        // already being answered finish with the previous one.
+        void update(const Wgraph& w, const Sessions* sessions = NULL) {
+            using namespace server_detail;
+            std::shared_ptr<Snapshot> s(new Snapshot);
+            s->graph = BuildQueryGraph(w, sessions);
+            s->components = ConnectedComponents(w);
+            s->hubs.assign(s->components.count(), ~0u);
+            for (unsigned v = 0; v != s->graph.nodeCount(); ++v) {
+                unsigned& hub = s->hubs[s->components.id[v]];
+                if (hub == ~0u || s->graph.adjacency.degree(v) > s->graph.adjacency.degree(hub)) hub = v;
+            }
+            std::lock_guard<std::mutex> lock(snapshotMutex);
+            s->version = snapshot ? snapshot->version + 1 : 1;
+            snapshot = s;
+        }
+
+        // Starts listening and the thread pool, false if the port can't be
+        // bound
+        bool start() {
+            if (epoll != -1) return true;
+            listener = socket(AF_INET, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+            int yes = 1;
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            sockaddr_in address;
+            std::memset(&address, 0, sizeof(address));
+            address.sin_family = AF_INET;
+            address.sin_port = htons(options.port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (listener == -1 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+                std::cerr << "ERROR: can't listen on port " << options.port << ": " << std::strerror(errno) << std::endl;
+                if (listener != -1) close(listener);
+                listener = -1;
+                return false;
+            }
+
+            epoll = epoll_create1(EPOLL_CLOEXEC);
+            wakeup = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+            // the listener is armed for one thread at a time like the
+            // connections, the wakeup stays armed so all threads see it
+            arm(listener, &listener, EPOLLIN, EPOLL_CTL_ADD);
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = &wakeup;
+            epoll_ctl(epoll, EPOLL_CTL_ADD, wakeup, &event);
+
+            const unsigned count = options.threads ? options.threads : DefaultThreadCount();
+            for (unsigned i = 0; i != count; ++i)
+                threads.push_back(std::thread(&GraphServer::work, this));
+            return true;
+        }
+
+        void stop() {
+            if (epoll == -1) return;
+            const unsigned long long one = 1;
+            if (write(wakeup, &one, sizeof(one)) != sizeof(one))
+                std::cerr << "ERROR: failed to wake the server threads" << std::endl;
+            for (std::size_t i = 0; i != threads.size(); ++i) threads[i].join();
+            threads.clear();
+            for (std::unordered_set<server_detail::Connection*>::iterator itr = connections.begin(); itr != connections.end(); itr++) {
+                close((*itr)->fd);
+                delete *itr;
+            }
+            connections.clear();
+            close(listener);
+            close(wakeup);
+            close(epoll);
+            listener = wakeup = epoll = -1;
+        }
+
+        // Answers a request target such as "/search?q=news" with a status
+        // and a JSON body, going through the cache. Used by the threads,
+        // exposed for testing without sockets.
+        server_detail::Response respond(const std::string& target) {
+            using namespace server_detail;
+            std::shared_ptr<const Snapshot> s;
+            {
+                std::lock_guard<std::mutex> lock(snapshotMutex);
+                s = snapshot;
+            }
+            {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                if (s && cacheVersion != s->version) {
+                    cache.clear();
+                    cacheVersion = s->version;
+                }
+                std::unordered_map<std::string, std::shared_ptr<const std::string> >::const_iterator found = cache.find(target);
+                if (found != cache.end()) {
+                    Response r = {200, found->second};
+                    return r;
+                }
+            }
+
+            std::string body;
+            const int status = s ? answer(*s, target, body) : 404;
+            if (!s) body = "{\"error\":\"no graph yet\"}";
+            Response r = {status, std::make_shared<const std::string>(body)};
+            if (status == 200) {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                // the snapshot may have been replaced meanwhile
+                if (cacheVersion == s->version) {
+                    if (cache.size() >= options.cacheSize) cache.clear();
+                    cache[target] = r.body;
+                }
+            }
+            return r;
+        }
+
+    private:
+        void arm(int fd, void* data, unsigned events, int operation = EPOLL_CTL_MOD) {
+            epoll_event event;
+            event.events = events|EPOLLONESHOT;
+            event.data.ptr = data;
+            epoll_ctl(epoll, operation, fd, &event);
+        }
+
+        void work() {
+            using namespace server_detail;
+            epoll_event events[16];
+            for (;;) {
+                const int count = epoll_wait(epoll, events, 16, -1);
+                if (count < 0 && errno != EINTR) {
+                    std::cerr << "ERROR: epoll_wait failed: " << std::strerror(errno) << std::endl;
+                    return;
+                }
+                for (int i = 0; i < count; ++i) {
+                    if (events[i].data.ptr == &wakeup) return;
+                    if (events[i].data.ptr == &listener) accept();
+                    else serve((Connection*)events[i].data.ptr);
+                }
+            }
+        }
+
+        void accept() {
+            using namespace server_detail;
+            for (;;) {
+                const int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK|SOCK_CLOEXEC);
+                if (fd == -1) break;
+                int yes = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                Connection* c = new Connection(fd);
+                {
+                    std::lock_guard<std::mutex> lock(connectionsMutex);
+                    connections.insert(c);
+                }
+                arm(fd, c, EPOLLIN, EPOLL_CTL_ADD);
+            }
+            arm(listener, &listener, EPOLLIN);
+        }
+
+        // Only the thread the connection was armed for gets here, so it
+        // needs no lock of its own
+        void serve(server_detail::Connection* c) {
+            using namespace server_detail;
+            if (c->body) {
+                const int flushed = flush(c);
+                if (flushed < 0) return drop(c);
+                if (flushed == 0) return arm(c->fd, c, EPOLLOUT);
+                if (c->close) return drop(c);
+            }
+
+            char buffer[4096];
+            while (c->input.size() < MaxInputBytes) {
+                const ssize_t received = recv(c->fd, buffer, sizeof(buffer), 0);
+                if (received > 0) c->input.append(buffer, received);
+                else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) return drop(c);
+                else if (errno != EINTR) break;
+            }
+
+            // pipelined requests are answered in order
+            for (;;) {
+                const std::size_t end = c->input.find("\r\n\r\n");
+                if (end == std::string::npos) {
+                    if (c->input.size() > MaxRequestBytes) return drop(c);
+                    break;
+                }
+                const std::string request = c->input.substr(0, end);
+                c->input.erase(0, end + 4);
+                prepare(c, request);
+                const int flushed = flush(c);
+                if (flushed < 0) return drop(c);
+                if (flushed == 0) return arm(c->fd, c, EPOLLOUT);
+                if (c->close) return drop(c);
+            }
+            arm(c->fd, c, EPOLLIN);
+        }
+
+        void prepare(server_detail::Connection* c, const std::string& request) {
+            using namespace server_detail;
+            std::istringstream lines(request);
+            std::string line, method, target, version;
+            std::getline(lines, line);
+            std::istringstream(line) >> method >> target >> version;
+            // HTTP/1.1 keeps the connection by default, 1.0 doesn't
+            bool keep = version == "HTTP/1.1";
+            bool body = false;
+            std::string host;
+            while (std::getline(lines, line)) {
+                std::string name = line.substr(0, line.find(':'));
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                std::string value = line.find(':') == std::string::npos ? std::string() : line.substr(line.find(':') + 1);
+                std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+                if (name == "host") {
+                    const std::size_t first = value.find_first_not_of(" \t\r");
+                    host = first == std::string::npos ? std::string() : value.substr(first, value.find_last_not_of(" \t\r") + 1 - first);
+                } else if (name == "connection") {
+                    if (value.find("close") != std::string::npos) keep = false;
+                    else if (value.find("keep-alive") != std::string::npos) keep = true;
+                } else if ((name == "content-length" && std::atol(value.c_str()) != 0) || name == "transfer-encoding")
+                    body = true;
+            }
+
+            const std::string port = std::to_string(options.port);
+            Response r;
+            if (host != "127.0.0.1:" + port && host != "localhost:" + port &&
+                (options.port != 80 || (host != "127.0.0.1" && host != "localhost"))) {
+                keep = false;
+                r.status = 403;
+                r.body = std::make_shared<const std::string>("{\"error\":\"wrong host\"}");
+            } else if (method != "GET" || body) {
+                // a request body isn't read, so it can't be kept either
+                keep = false;
+                r.status = 405;
+                r.body = std::make_shared<const std::string>("{\"error\":\"only GET is supported\"}");
+            } else r = respond(target);
+
+            c->head = "HTTP/1.1 " + std::to_string(r.status) + " " + StatusText(r.status) + "\r\n"
+                "Content-Type: application/json\r\n"
+                "Content-Length: " + std::to_string(r.body->size()) + "\r\n" +
+                (keep ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+            c->body = r.body;
+            c->sent = 0;
+            c->close = !keep;
+        }
+
+        // 1 if the response is all written, 0 if the socket is full, -1 on
+        // error
+        int flush(server_detail::Connection* c) {
+            for (;;) {
+                const std::size_t total = c->head.size() + c->body->size();
+                if (c->sent == total) {
+                    c->body.reset();
+                    return 1;
+                }
+                iovec parts[2];
+                int count = 0;
+                if (c->sent < c->head.size()) {
+                    parts[count].iov_base = &c->head[c->sent];
+                    parts[count++].iov_len = c->head.size() - c->sent;
+                }
+                const std::size_t bodySent = c->sent > c->head.size() ? c->sent - c->head.size() : 0;
+                parts[count].iov_base = const_cast<char*>(c->body->data()) + bodySent;
+                parts[count++].iov_len = c->body->size() - bodySent;
+                msghdr message;
+                std::memset(&message, 0, sizeof(message));
+                message.msg_iov = parts;
+                message.msg_iovlen = count;
+                const ssize_t written = sendmsg(c->fd, &message, MSG_NOSIGNAL);
+                if (written >= 0) c->sent += written;
+                else if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+                else if (errno != EINTR) return -1;
+            }
+        }
+
+        void drop(server_detail::Connection* c) {
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                connections.erase(c);
+            }
+            close(c->fd);
+            delete c;
+        }
+
+        int answer(const server_detail::Snapshot& s, const std::string& target, std::string& body) const {
+            using namespace server_detail;
+            const QueryGraph& g = s.graph;
+            const Adjacency& a = g.adjacency;
+            std::unordered_map<std::string, std::string> parameters;
+            const std::string path = ParseTarget(target, parameters);
+
+            unsigned hops = 2, limit = path == "/subgraph" || path == "/query" ? 200 : 20;
+            if (!ParseCount(parameters, "hops", hops) || !ParseCount(parameters, "limit", limit)) {
+                body = "{\"error\":\"bad hops or limit\"}";
+                return 400;
+            }
+            // looks up a tag parameter, the error is left in the body
+            auto node = [&](const char* name, unsigned& id) -> bool {
+                std::unordered_map<std::string, unsigned>::const_iterator found = g.tagIds.find(parameters[name]);
+                if (found == g.tagIds.end()) {
+                    body = "{\"error\":";
+                    JsonString(body, "no node " + parameters[name]);
+                    body += "}";
+                    return false;
+                }
+                id = found->second;
+                return true;
+            };
+
+            if (path == "/subgraph") {
+                unsigned source;
+                if (!node("node", source)) return 404;
+                // breadth first until the limit, so the nearest are kept
+                std::unordered_map<unsigned, unsigned> level;
+                std::vector<unsigned> nodes(1, source);
+                level[source] = 0;
+                for (std::size_t i = 0; i != nodes.size() && nodes.size() < limit; ++i) {
+                    const unsigned v = nodes[i];
+                    if (level[v] == hops) break;
+                    for (const unsigned* u = a.begin(v); u != a.end(v) && nodes.size() < limit; ++u)
+                        if (level.insert(std::make_pair(*u, level[v] + 1)).second) nodes.push_back(*u);
+                }
+                body = "{";
+                NodesJson(body, g, nodes);
+                body += ",\"links\":[";
+                bool first = true;
+                for (std::size_t i = 0; i != nodes.size(); ++i)
+                    for (std::size_t e = a.offsets[nodes[i]]; e != a.offsets[nodes[i] + 1]; ++e) {
+                        const unsigned u = a.neighbours[e];
+                        // each undirected edge once
+                        if (u < nodes[i] || !level.count(u)) continue;
+                        body += first ? "{\"source\":" : ",{\"source\":";
+                        first = false;
+                        JsonString(body, g.tags[nodes[i]]);
+                        body += ",\"target\":";
+                        JsonString(body, g.tags[u]);
+                        body += ",\"weight\":" + std::to_string(a.weights[e]) + "}";
+                    }
+                body += "]}";
+
+            } else if (path == "/search") {
+                const std::string text = parameters["q"];
+                std::vector<unsigned> nodes;
+                for (unsigned v = 0; v != g.nodeCount() && nodes.size() < limit; ++v)
+                    if (g.tags[v].find(text) != std::string::npos || g.links[v].find(text) != std::string::npos)
+                        nodes.push_back(v);
+                body = "{";
+                NodesJson(body, g, nodes);
+                body += "}";
+
+            } else if (path == "/path") {
+                unsigned from, to;
+                if (!node("from", from) || !node("to", to)) return 404;
+                std::vector<unsigned> parent(g.nodeCount(), ~0u), frontier(1, from);
+                parent[from] = from;
+                for (std::size_t i = 0; i != frontier.size() && parent[to] == ~0u; ++i)
+                    for (const unsigned* u = a.begin(frontier[i]); u != a.end(frontier[i]); ++u)
+                        if (parent[*u] == ~0u) {
+                            parent[*u] = frontier[i];
+                            frontier.push_back(*u);
+                        }
+                std::vector<unsigned> nodes;
+                if (parent[to] != ~0u) {
+                    for (unsigned v = to; v != from; v = parent[v]) nodes.push_back(v);
+                    nodes.push_back(from);
+                    std::reverse(nodes.begin(), nodes.end());
+                }
+                body = "{\"path\":[";
+                for (std::size_t i = 0; i != nodes.size(); ++i) {
+                    if (i) body += ',';
+                    JsonString(body, g.tags[nodes[i]]);
+                }
+                body += "]}";
+
+            } else if (path == "/clusters") {
+                const Components& c = s.components;
+                std::vector<unsigned> order(c.count());
+                for (unsigned i = 0; i != c.count(); ++i) order[i] = i;
+                const std::size_t kept = std::min<std::size_t>(limit, order.size());
+                std::partial_sort(order.begin(), order.begin() + kept, order.end(), [&c](unsigned x, unsigned y) {
+                    return c.sizes[x] != c.sizes[y] ? c.sizes[x] > c.sizes[y] : x < y;
+                });
+                body = "{\"count\":" + std::to_string(c.count()) + ",\"isolated\":" + std::to_string(c.isolated.size()) + ",\"clusters\":[";
+                for (std::size_t i = 0; i != kept; ++i) {
+                    body += i ? ",{\"size\":" : "{\"size\":";
+                    body += std::to_string(c.sizes[order[i]]) + ",\"hub\":";
+                    NodeJson(body, g, s.hubs[order[i]]);
+                    body += "}";
+                }
+                body += "]}";
+
+            } else if (path == "/query") {
+                QueryPlan plan;
+                std::string error;
+                if (!CompileQuery(parameters["q"], g, plan, error)) {
+                    body = "{\"error\":";
+                    JsonString(body, error);
+                    body += "}";
+                    return 400;
+                }
+                const QuerySelection result = RunQuery(plan, g);
+                body = "{\"count\":" + std::to_string(result.ids.size()) + ",\"nodes\":[";
+                for (std::size_t i = 0; i != std::min<std::size_t>(limit, result.ids.size()); ++i) {
+                    if (i) body += ',';
+                    NodeJson(body, g, result.ids[i], &result.weights[i]);
+                }
+                body += "]}";
+
+            } else {
+                body = "{\"error\":\"unknown path\"}";
+                return 404;
+            }
+            return 200;
+        }
+
+        ServerOptions options;
+        int listener, epoll, wakeup;
+        std::vector<std::thread> threads;
+
+        std::mutex snapshotMutex;
+        std::shared_ptr<const server_detail::Snapshot> snapshot;
+
+        std::mutex cacheMutex;
+        unsigned long long cacheVersion; // of the snapshot the cache is for
+        std::unordered_map<std::string, std::shared_ptr<const std::string> > cache;
+
+        std::mutex connectionsMutex;
+        std::unordered_set<server_detail::Connection*> connections;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef SESSIONS_H
+#define SESSIONS_H
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "edgelist.h"
+
+// Splits the visit stream into browsing sessions. A visit continues the
+// session of the page it was referred from while that one is still open,
+// otherwise the session open in its tab, otherwise it starts a new one. A
+// session is open until it's idle for longer than the gap. Visits are only
+// linked within a session, so a page seen today and one from last month
+// don't become neighbours.
+struct SessionOptions {
+    SessionOptions(): idleGap(30*60), keepClosed(true) {}
+
+    long long idleGap; // seconds
+    // if false, only what's needed to link the next visits is kept, for a
+    // stream that has to run in bounded memory. Sessions idle for longer
+    // than the gap before the newest visit are dropped now and then, and
+    // the open ones keep just their last visit and no edges.
+    bool keepClosed;
+};
+
+struct Session {
+    std::string tab;
+    long long start;              // time of the first visit
+    long long end;                // time of the last visit
+    std::vector<unsigned> visits; // page IDs in visit order
+    std::vector<long long> times; // time of each visit, NoTime if it had none
+    EdgeList edges;               // links made within the session, from the earlier page
+};
+
+class Sessions {
+    public:
+        // Visits without a time never end a session by idling
+        static const long long NoTime = LLONG_MIN;
+
+        // Rough heap cost of a page and of a session, not counting the
+        // strings and the visits
+        static const std::size_t PageBytes = 96;
+        static const std::size_t SessionBytes = sizeof(Session) + 64;
+
+        explicit Sessions(const SessionOptions& o = SessionOptions()) : options(o), newest(NoTime), nextSerial(0), sweepAt(MinSweep), bytes(0) {}
+
+        // Session IDs change when closed ones are dropped
+        unsigned count() const { return list.size(); }
+        const Session& operator[](unsigned id) const { return list[id]; }
+
+        // Page IDs are given in order of first visit, and reused for new
+        // pages once forgotten ones are gone from all sessions kept
+        unsigned pageCount() const { return tags.size(); }
+        const std::string& tag(unsigned page) const { return tags[page]; }
+
+        // Estimated bytes of everything kept
+        std::size_t memoryBytes() const { return bytes; }
+
+        // Records a visit. Returns true and fills from with the tag of the
+        // page it links to if it continues a session. From is empty if that
+        // page was forgotten meanwhile.
+        bool visit(const std::string& tag, long long time, const std::string& tab, const std::string& referrer, std::string& from) {
+            if (time != NoTime) newest = std::max(newest, time);
+            if (!options.keepClosed && (list.size() >= sweepAt || forgotten.size() >= std::max(std::size_t(MinSweep), list.size()))) sweep();
+
+            const unsigned page = pageId(tag);
+            std::size_t session = None;
+            unsigned previous = 0;
+
+            if (!referrer.empty()) {
+                std::unordered_map<std::string, unsigned>::const_iterator r = ids.find(referrer);
+                if (r != ids.end()) {
+                    const std::size_t found = position(lastSession[r->second]);
+                    if (found != None && open(found, time)) {
+                        session = found;
+                        previous = r->second;
+                    }
+                }
+            }
+            if (session == None) {
+                std::map<std::string, std::size_t>::const_iterator t = tabSessions.find(tab);
+                const std::size_t found = t == tabSessions.end() ? std::size_t(None) : position(t->second);
+                if (found != None && open(found, time) && !list[found].visits.empty()) {
+                    session = found;
+                    previous = list[session].visits.back();
+                }
+            }
+
+            const bool linked = session != None;
+            if (!linked) {
+                session = list.size();
+                list.push_back(Session());
+                list.back().tab = tab;
+                list.back().start = time;
+                list.back().end = time;
+                serials.push_back(nextSerial);
+                if (!options.keepClosed) positions.insert(std::make_pair(nextSerial, session));
+                ++nextSerial;
+                bytes += SessionBytes + 2*tab.size();
+            }
+            Session& s = list[session];
+            if (linked) from = tags[previous];
+            if (!options.keepClosed) {
+                s.visits.assign(1, page);
+                s.times.assign(1, time);
+                if (!linked) bytes += sizeof(unsigned) + sizeof(long long);
+            } else {
+                if (linked) {
+                    s.edges.push_back(std::make_pair(previous, page));
+                    bytes += sizeof(std::pair<unsigned, unsigned>);
+                }
+                s.visits.push_back(page);
+                s.times.push_back(time);
+                bytes += sizeof(unsigned) + sizeof(long long);
+            }
+            if (time != NoTime) {
+                if (s.start == NoTime) s.start = time;
+                s.end = time;
+            }
+            tabSessions[tab] = serials[session];
+            lastSession[page] = serials[session];
+            return linked;
+        }
+
+        // Forgets a page, e.g. once it's evicted from the graph. A later
+        // visit to it starts over as a new page. Sessions kept with the
+        // history keep it, otherwise it's dropped from them on the next
+        // sweep.
+        void forget(const std::string& tag) {
+            std::unordered_map<std::string, unsigned>::iterator itr = ids.find(tag);
+            if (itr == ids.end()) return;
+            bytes -= std::min(bytes, PageBytes + 2*tag.size());
+            if (!options.keepClosed) {
+                forgotten.insert(itr->second);
+                std::string().swap(tags[itr->second]);
+            }
+            ids.erase(itr);
+        }
+
+    private:
+        // only ever used by value, as they have no definition outside of the
+        // class
+        static const std::size_t None = ~std::size_t(0);
+        static const std::size_t MinSweep = 64;
+
+        unsigned pageId(const std::string& tag) {
+            std::unordered_map<std::string, unsigned>::const_iterator itr = ids.find(tag);
+            if (itr != ids.end()) return itr->second;
+            bytes += PageBytes + 2*tag.size();
+            unsigned page;
+            if (!freePages.empty()) {
+                page = freePages.back();
+                freePages.pop_back();
+                tags[page] = tag;
+                lastSession[page] = None;
+            } else {
+                page = tags.size();
+                tags.push_back(tag);
+                lastSession.push_back(std::size_t(None));
+            }
+            ids.insert(std::make_pair(tag, page));
+            return page;
+        }
+
+        // Position of a session in the list, None if it was dropped. Nothing
+        // is dropped while keeping closed sessions, so it's the serial.
+        std::size_t position(std::size_t serial) const {
+            if (options.keepClosed || serial == None) return serial;
+            std::unordered_map<std::size_t, std::size_t>::const_iterator found = positions.find(serial);
+            return found == positions.end() ? std::size_t(None) : found->second;
+        }
+        bool open(std::size_t session, long long time) const {
+            const long long end = list[session].end;
+            return time == NoTime || end == NoTime || time - end <= options.idleGap;
+        }
+
+        // Drops sessions that are closed as of the newest visit, and the
+        // forgotten pages from the ones left, after which their IDs can be
+        // reused. Pages and tabs of dropped sessions find them gone by the
+        // serial. The list has to double or as many pages as there are
+        // sessions have to be forgotten before the next sweep, which keeps it
+        // to a constant amount of work per visit.
+        void sweep() {
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i != list.size(); ++i) {
+                Session& s = list[i];
+                if (s.end != NoTime && newest != NoTime && newest - s.end > options.idleGap) {
+                    bytes -= std::min(bytes, SessionBytes + 2*s.tab.size() + s.visits.size()*(sizeof(unsigned) + sizeof(long long)));
+                    positions.erase(serials[i]);
+                    continue;
+                }
+                if (!forgotten.empty()) purge(s);
+                if (kept != i) {
+                    std::swap(list[kept], list[i]);
+                    serials[kept] = serials[i];
+                    positions[serials[kept]] = kept;
+                }
+                ++kept;
+            }
+            list.resize(kept);
+            serials.resize(kept);
+
+            for (std::map<std::string, std::size_t>::iterator itr = tabSessions.begin(); itr != tabSessions.end(); ) {
+                if (positions.count(itr->second)) ++itr;
+                else tabSessions.erase(itr++);
+            }
+            freePages.insert(freePages.end(), forgotten.begin(), forgotten.end());
+            forgotten.clear();
+            sweepAt = std::max(std::size_t(MinSweep), 2*kept);
+        }
+
+        // removes visits to forgotten pages, only the last visit is kept
+        // when sweeping so there are no edges
+        void purge(Session& s) {
+            std::size_t out = 0;
+            for (std::size_t i = 0; i != s.visits.size(); ++i) {
+                if (forgotten.count(s.visits[i])) continue;
+                s.visits[out] = s.visits[i];
+                s.times[out++] = s.times[i];
+            }
+            bytes -= std::min(bytes, (s.visits.size() - out)*(sizeof(unsigned) + sizeof(long long)));
+            s.visits.resize(out);
+            s.times.resize(out);
+        }
+
+        SessionOptions options;
+        std::vector<Session> list;
+        std::vector<std::size_t> serials;                 // of each session in the list
+        std::unordered_map<std::size_t, std::size_t> positions; // serial to position, if not keeping closed ones
+        std::vector<std::string> tags;
+        std::unordered_map<std::string, unsigned> ids;
+        std::vector<std::size_t> lastSession;             // serial of the last session of each page
+        std::map<std::string, std::size_t> tabSessions;   // serial of the last session of each tab
+        std::unordered_set<unsigned> forgotten;           // pages still in some sessions
+        std::vector<unsigned> freePages;                  // page IDs to reuse
+        long long newest;                                 // time of the newest visit
+        std::size_t nextSerial;
+        std::size_t sweepAt;                              // session count of the next sweep
+        std::size_t bytes;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef TRAVERSAL_H
+#define TRAVERSAL_H
+
+#include <vector>
+
+// Breadth-first hop counts from source to every node, ~0u for unreachable
+// ones. Takes anything with nodeCount() and neighboursOf(), so Adjacency
+// and CompressedAdjacency both work.
+template<class Graph> inline std::vector<unsigned> HopDistances(const Graph& g, unsigned source) {
+    const unsigned Unreached = ~0u;
+    std::vector<unsigned> distance(g.nodeCount(), Unreached);
+    std::vector<unsigned> queue;
+    std::vector<unsigned> neighbours;
+    queue.reserve(g.nodeCount());
+    distance[source] = 0;
+    queue.push_back(source);
+    for (std::size_t head = 0; head != queue.size(); ++head) {
+        const unsigned v = queue[head];
+        g.neighboursOf(v, neighbours);
+        for (std::size_t i = 0; i != neighbours.size(); ++i) {
+            if (distance[neighbours[i]] != Unreached) continue;
+            distance[neighbours[i]] = distance[v] + 1;
+            queue.push_back(neighbours[i]);
+        }
+    }
+    return distance;
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef WGRAPH_H
+#define WGRAPH_H
+
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -11,16 +14,36 @@ class Node {
         Node() : tag(""), link(""), size(0) {}
         Node(std::string t, std::string l, int s) : tag(t), link(l), size(s) {}
 
-        void add(Node * n) { adj.push_back(n); }
+        // links both ways, an edge to itself gets two entries
+        static void join(Node * a, Node * b) {
+            a->adj.push_back(b);
+            std::list<Node*>::iterator toB = --a->adj.end();
+            b->adj.push_back(a);
+            std::list<Node*>::iterator toA = --b->adj.end();
+            a->twins.push_back(Twin());
+            b->twins.push_back(Twin());
+            a->twins.back().entry = toA;
+            a->twins.back().twin = --b->twins.end();
+            b->twins.back().entry = toB;
+            b->twins.back().twin = --a->twins.end();
+        }
 
         friend std::ostream& operator<<(std::ostream& ostr, Node* n);
 
+        // Where the other end of each adj entry is, so removing a node
+        // unlinks each of its edges in constant time
+        struct Twin {
+            std::list<Node*>::iterator entry;
+            std::list<Twin>::iterator twin;
+        };
+
         std::string tag;
         std::string link;
         int size;
         std::list<Node*> adj;
+        std::list<Twin> twins; // parallel to adj
 };
-std::ostream& operator<<(std::ostream& ostr, Node* n) {
+inline std::ostream& operator<<(std::ostream& ostr, Node* n) {
     ostr << "(" << n->tag << "," <<  n->link << "," << n->size << ")";
     return ostr;
 }
@@ -28,12 +51,33 @@ std::ostream& operator<<(std::ostream& ostr, Node* n) {
 class Wgraph {
     public:
         Wgraph() : N(0) {}
+        // owns its nodes, so it can be moved but not copied
+        Wgraph(Wgraph&& other) : N(other.N) { table.swap(other.table); }
+        ~Wgraph() {
+            for (std::map<std::string,Node*>::iterator itr = table.begin(); itr != table.end(); itr++)
+                delete itr->second;
+        }
         int size() const { return N; }
-        void add(std::string t, std::string l, int s) { table.insert(make_pair(t,new Node(t,l,s))); }
-        void connect(std::string t1, std::string t2) { find(t1)->add(find(t2)); find(t2)->add(find(t1)); }
+        void add(std::string t, std::string l, int s) { if (table.find(t) == table.end()) table.insert(make_pair(t,new Node(t,l,s))); }
+        void connect(std::string t1, std::string t2) { Node::join(find(t1), find(t2)); }
+        // removes the node and all its edges
+        void remove(std::string t) {
+            std::map<std::string,Node*>::iterator itr = table.find(t);
+            if (itr == table.end()) return;
+            Node* n = itr->second;
+            std::list<Node::Twin>::iterator twin = n->twins.begin();
+            for (std::list<Node*>::iterator itr2 = n->adj.begin(); itr2 != n->adj.end(); itr2++, twin++)
+                if (*itr2 != n) {
+                    (*itr2)->adj.erase(twin->entry);
+                    (*itr2)->twins.erase(twin->twin);
+                }
+            table.erase(itr);
+            delete n;
+        }
         Node * find(std::string t) {
             if(table.find(t) != table.end()) return table.find(t)->second;
             else return NULL; }
+        const std::map<std::string,Node*>& nodes() const { return table; }
         void printConnect() { 
             int i = 0;
             for (std::map<std::string,Node*>::iterator itr = table.begin(); itr != table.end(); itr++, i++) {
@@ -54,4 +98,6 @@ class Wgraph {
         int N; // number of nodes in graph.
         std::map<std::string,Node*> table; // easy access
 
-};
\ No newline at end of file
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "DensityRenderer.h"
+
+#include <cmath>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Containers/StringView.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/DebugTools/ColorMap.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Attribute.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/DefaultFramebuffer.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/Sampler.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/ImageView.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/MeshTools/FullScreenTriangle.h>
+#include <Magnum/PixelFormat.h>
+
+#include "GraphData.h"
+
+namespace Breadcrumbs {
+
+namespace {
+
+/* Accumulation texture is this many times smaller than the framebuffer in
+   each direction, the resolve filters it back up */
+constexpr Int Downsample = 2;
+
+/* Splat diameter in accumulation texture pixels */
+constexpr Float SplatSize = 8.0f;
+
+/* This many average nodes stacked on a pixel reach the top of the color
+   map */
+constexpr Float Saturation = 256.0f;
+
+enum: Int {
+    DensityTextureUnit = 0,
+    ColorMapTextureUnit = 1
+};
+
+}
+
+class DensityRenderer::SplatShader: public GL::AbstractShaderProgram {
+    public:
+        typedef GL::Attribute<0, Vector2> Position;
+        typedef GL::Attribute<1, Float> Weight;
+
+        explicit SplatShader() {
+            const Utility::Resource rs{"breadcrumbs-shaders"};
+            GL::Shader vert{GL::Version::GL330, GL::Shader::Type::Vertex};
+            GL::Shader frag{GL::Version::GL330, GL::Shader::Type::Fragment};
+            vert.addSource(rs.getString("DensitySplat.vert"));
+            frag.addSource(rs.getString("DensitySplat.frag"));
+            CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, frag}));
+            attachShaders({vert, frag});
+            CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+            _transformationProjectionMatrixUniform = uniformLocation("transformationProjectionMatrix");
+            setUniform(uniformLocation("pointSize"), SplatSize);
+        }
+
+        SplatShader& setTransformationProjectionMatrix(const Matrix3& matrix) {
+            setUniform(_transformationProjectionMatrixUniform, matrix);
+            return *this;
+        }
+
+    private:
+        Int _transformationProjectionMatrixUniform;
+};
+
+class DensityRenderer::ResolveShader: public GL::AbstractShaderProgram {
+    public:
+        explicit ResolveShader() {
+            const Utility::Resource rs{"breadcrumbs-shaders"};
+            GL::Shader vert{GL::Version::GL330, GL::Shader::Type::Vertex};
+            GL::Shader frag{GL::Version::GL330, GL::Shader::Type::Fragment};
+            vert.addSource(rs.getString("DensityResolve.vert"));
+            frag.addSource(rs.getString("DensityResolve.frag"));
+            CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, frag}));
+            attachShaders({vert, frag});
+            CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+            setUniform(uniformLocation("densityTexture"), DensityTextureUnit);
+            setUniform(uniformLocation("colorMapTexture"), ColorMapTextureUnit);
+            setUniform(uniformLocation("logSaturationScale"), 1.0f/std::log(1.0f + Saturation));
+            _densityScaleUniform = uniformLocation("densityScale");
+        }
+
+        ResolveShader& setDensityScale(Float scale) {
+            setUniform(_densityScaleUniform, scale);
+            return *this;
+        }
+
+        ResolveShader& bindTextures(GL::Texture2D& density, GL::Texture2D& colorMap) {
+            density.bind(DensityTextureUnit);
+            colorMap.bind(ColorMapTextureUnit);
+            return *this;
+        }
+
+    private:
+        Int _densityScaleUniform;
+};
+
+DensityRenderer::DensityRenderer(const GraphData& graph, const Vector2i& framebufferSize) {
+    MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL330);
+
+    _splatShader.emplace();
+    _resolveShader.emplace();
+
+    /* A node weighs as much as it was visited, counted over its edges, and
+       at least one so lone nodes still show up */
+    Containers::Array<Float> weights{DirectInit, graph.nodeCount(), 0.0f};
+    for(std::size_t i = 0; i != graph.edges.size(); ++i) {
+        weights[graph.edges[i].x()] += graph.edgeWeights[i];
+        weights[graph.edges[i].y()] += graph.edgeWeights[i];
+    }
+    Double weightSum = 0.0;
+    for(Float& weight: weights) {
+        weight = Math::max(weight, 1.0f);
+        weightSum += Double(weight);
+    }
+    _meanWeight = weights.isEmpty() ? 1.0f : Float(weightSum/weights.size());
+    _weights.setData(weights, GL::BufferUsage::StaticDraw);
+
+    _splatMesh.setCount(graph.nodeCount())
+        .addVertexBuffer(_positions, 0, SplatShader::Position{})
+        .addVertexBuffer(_weights, 0, SplatShader::Weight{});
+    _resolveMesh = MeshTools::fullScreenTriangle();
+
+    _colorMap.setMinificationFilter(GL::SamplerFilter::Linear)
+        .setMagnificationFilter(GL::SamplerFilter::Linear)
+        .setWrapping(GL::SamplerWrapping::ClampToEdge)
+        .setStorage(1, GL::TextureFormat::RGB8, {256, 1})
+        .setSubImage(0, {}, ImageView2D{PixelFormat::RGB8Unorm, {256, 1}, DebugTools::ColorMap::turbo()});
+
+    setViewport(framebufferSize);
+}
+
+DensityRenderer::~DensityRenderer() = default;
+
+void DensityRenderer::setViewport(const Vector2i& framebufferSize) {
+    const Vector2i size = Math::max(framebufferSize/Downsample, Vector2i{1});
+    _density = GL::Texture2D{};
+    _density.setMinificationFilter(GL::SamplerFilter::Linear)
+        .setMagnificationFilter(GL::SamplerFilter::Linear)
+        .setWrapping(GL::SamplerWrapping::ClampToEdge)
+        .setStorage(1, GL::TextureFormat::R32F, size);
+    _framebuffer = GL::Framebuffer{{{}, size}};
+    _framebuffer.attachTexture(GL::Framebuffer::ColorAttachment{0}, _density, 0);
+}
+
+void DensityRenderer::draw(const Containers::ArrayView<const Vector2> positions, const Matrix3& transformationProjection) {
+    _positions.setData(positions, GL::BufferUsage::StreamDraw);
+    _dataSize = positions.size()*sizeof(Vector2);
+
+    /* Splats add up, restoring the usual blending for the resolve and
+       whatever comes after */
+    _framebuffer.clearColor(0, Color4{})
+        .bind();
+    GL::Renderer::enable(GL::Renderer::Feature::ProgramPointSize);
+    GL::Renderer::setBlendFunction(GL::Renderer::BlendFunction::One,
+        GL::Renderer::BlendFunction::One);
+    _splatShader->setTransformationProjectionMatrix(transformationProjection)
+        .draw(_splatMesh);
+    GL::Renderer::setBlendFunction(GL::Renderer::BlendFunction::SourceAlpha,
+        GL::Renderer::BlendFunction::OneMinusSourceAlpha);
+    GL::Renderer::disable(GL::Renderer::Feature::ProgramPointSize);
+
+    GL::defaultFramebuffer.bind();
+    _resolveShader->setDensityScale(1.0f/_meanWeight)
+        .bindTextures(_density, _colorMap)
+        .draw(_resolveMesh);
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef DensityRenderer_h
+#define DensityRenderer_h
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Matrix3.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+struct GraphData;
+
+/* Density view for graphs too large to draw node by node. Every node is a
+   point sprite with a smooth falloff, weighted by its visit count and added
+   into a float texture at a fraction of the framebuffer resolution. A
+   full-screen pass then maps the log of the density through the turbo color
+   map. The cost is one splat per node plus a fixed-size resolve, however
+   many of them overlap. */
+class DensityRenderer {
+    public:
+        explicit DensityRenderer(const GraphData& graph, const Vector2i& framebufferSize);
+
+        ~DensityRenderer();
+
+        DensityRenderer(const DensityRenderer&) = delete;
+        DensityRenderer& operator=(const DensityRenderer&) = delete;
+
+        /* Reallocates the accumulation texture */
+        void setViewport(const Vector2i& framebufferSize);
+
+        /* Accumulates the positions and draws the color-mapped result over
+           the default framebuffer, leaving it bound */
+        void draw(Containers::ArrayView<const Vector2> positions, const Matrix3& transformationProjection);
+
+        /* Bytes uploaded by the last draw() */
+        std::size_t dataSize() const { return _dataSize; }
+
+    private:
+        class SplatShader;
+        class ResolveShader;
+
+        Containers::Pointer<SplatShader> _splatShader;
+        Containers::Pointer<ResolveShader> _resolveShader;
+        GL::Buffer _positions, _weights;
+        GL::Mesh _splatMesh{GL::MeshPrimitive::Points}, _resolveMesh{NoCreate};
+        GL::Texture2D _density{NoCreate}, _colorMap;
+        GL::Framebuffer _framebuffer{NoCreate};
+        /* Density of a single average node at its center */
+        Float _meanWeight{};
+        std::size_t _dataSize{};
+};
+
+}
+
+#endif
@@ -0,0 +1,21 @@
+uniform highp sampler2D densityTexture;
+uniform lowp sampler2D colorMapTexture;
+/* Reciprocal of the density of a single average node */
+uniform highp float densityScale;
+/* Reciprocal of the log of the density that maps to the top of the color
+   map */
+uniform highp float logSaturationScale;
+
+in highp vec2 textureCoordinates;
+
+out lowp vec4 fragmentColor;
+
+void main() {
+    highp float density = texture(densityTexture, textureCoordinates).r;
+    highp float value = clamp(log(1.0 + density*densityScale)*logSaturationScale, 0.0, 1.0);
+
+    /* Sampling texel centers so the ends of the map don't blend with the
+       clamped border, and the sparsest areas fade into the background */
+    lowp vec3 color = texture(colorMapTexture, vec2(value*255.0/256.0 + 0.5/256.0, 0.5)).rgb;
+    fragmentColor = vec4(color, min(value*16.0, 1.0));
+}
@@ -0,0 +1,9 @@
+/* Attribute-less full screen triangle from MeshTools::fullScreenTriangle() */
+
+out highp vec2 textureCoordinates;
+
+void main() {
+    gl_Position = vec4((gl_VertexID == 2) ?  3.0 : -1.0,
+                       (gl_VertexID == 1) ? -3.0 :  1.0, 0.0, 1.0);
+    textureCoordinates = gl_Position.xy*0.5 + vec2(0.5);
+}
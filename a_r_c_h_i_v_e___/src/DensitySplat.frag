@@ -0,0 +1,12 @@
+flat in highp float splatWeight;
+
+out highp float density;
+
+void main() {
+    /* Biweight kernel, one in the center and smoothly zero at the edge */
+    highp vec2 offset = gl_PointCoord*2.0 - vec2(1.0);
+    highp float distanceSquared = dot(offset, offset);
+    if(distanceSquared >= 1.0) discard;
+    highp float falloff = 1.0 - distanceSquared;
+    density = splatWeight*falloff*falloff;
+}
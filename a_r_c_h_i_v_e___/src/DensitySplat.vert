@@ -0,0 +1,16 @@
+/* A point sprite per node, sized in accumulation texture pixels so the
+   kernel is the same at any zoom */
+
+uniform highp mat3 transformationProjectionMatrix;
+uniform highp float pointSize;
+
+layout(location = 0) in highp vec2 position;
+layout(location = 1) in highp float weight;
+
+flat out highp float splatWeight;
+
+void main() {
+    gl_Position = vec4((transformationProjectionMatrix*vec3(position, 1.0)).xy, 0.0, 1.0);
+    gl_PointSize = pointSize;
+    splatWeight = weight;
+}
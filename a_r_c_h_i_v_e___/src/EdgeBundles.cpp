@@ -0,0 +1,285 @@
+#include "EdgeBundles.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+
+#include "SpatialGrid.h"
+
+namespace Breadcrumbs {
+
+namespace {
+
+/* Pulling towards more than this many edges doesn't change the shape much,
+   but the cost grows linearly */
+constexpr UnsignedInt MaxCompatible = 16;
+constexpr UnsignedInt Reversed = 1u << 31;
+constexpr Float CompatibilityThreshold = 0.6f;
+
+/* Candidates are this many edges with the closest midpoints. Position
+   compatibility falls off with the midpoint distance, so what's further
+   rarely makes it over the threshold, and it keeps long edges in a dense
+   graph from testing against everything. */
+constexpr std::size_t CandidateCount = 64;
+
+/* Ends with 16 inner points per edge. Iterations shrink by a third and the
+   step halves every cycle. The step is relative to the mean edge length so
+   the result doesn't depend on the layout scale. */
+constexpr UnsignedInt CycleCount = 5;
+constexpr UnsignedInt FirstIterationCount = 50;
+constexpr Float IterationRate = 2.0f/3.0f;
+constexpr Float FirstStepSize = 0.002f;
+constexpr Float SpringConstant = 0.1f;
+
+constexpr Float MinLength = 1.0e-4f;
+
+/* Runs f(thread) on threadCount threads, the calling thread is the last
+   one */
+template<class F> void runThreads(const UnsignedInt threadCount, const F& f) {
+    Containers::Array<std::thread> threads{threadCount - 1};
+    for(UnsignedInt t = 0; t != threads.size(); ++t)
+        threads[t] = std::thread{f, t};
+    f(threadCount - 1);
+    for(std::thread& thread: threads) thread.join();
+}
+
+/* Contiguous part of [0, count) a thread takes */
+inline std::pair<std::size_t, std::size_t> threadRange(const std::size_t count, const UnsignedInt threadCount, const UnsignedInt thread) {
+    const std::size_t chunk = (count + threadCount - 1)/threadCount;
+    return {Math::min(thread*chunk, count), Math::min((thread + 1)*chunk, count)};
+}
+
+/* Splits [0, count) into a contiguous range per thread */
+template<class F> void parallelFor(const std::size_t count, const UnsignedInt threadCount, const F& f) {
+    runThreads(threadCount, [&](const UnsignedInt thread) {
+        const std::pair<std::size_t, std::size_t> range = threadRange(count, threadCount, thread);
+        f(range.first, range.second);
+    });
+}
+
+/* Reusable barrier for a fixed number of threads */
+class Barrier {
+    public:
+        explicit Barrier(UnsignedInt count): _count{count} {}
+
+        void wait() {
+            std::unique_lock<std::mutex> lock{_mutex};
+            const UnsignedLong generation = _generation;
+            if(++_arrived == _count) {
+                _arrived = 0;
+                ++_generation;
+                _condition.notify_all();
+            } else _condition.wait(lock, [&]{ return generation != _generation; });
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        const UnsignedInt _count;
+        UnsignedInt _arrived{};
+        UnsignedLong _generation{};
+};
+
+/* How much of Q projected on the line of P lies over P itself */
+Float visibility(const Vector2& p0, const Vector2& p1, const Vector2& q0, const Vector2& q1) {
+    const Vector2 p = p1 - p0;
+    const Float inverseLengthSquared = 1.0f/p.dot();
+    const Vector2 i0 = p0 + p*(Math::dot(q0 - p0, p)*inverseLengthSquared);
+    const Vector2 i1 = p0 + p*(Math::dot(q1 - p0, p)*inverseLengthSquared);
+    const Float width = (i1 - i0).length();
+    if(width < MinLength) return 0.0f;
+    return Math::max(1.0f - 2.0f*((p0 + p1) - (i0 + i1)).length()*0.5f/width, 0.0f);
+}
+
+/* Product of the angle, scale, position and visibility compatibility */
+Float compatibility(const Vector2& p0, const Vector2& p1, const Vector2& q0, const Vector2& q1) {
+    const Vector2 p = p1 - p0, q = q1 - q0;
+    const Float lp = p.length(), lq = q.length();
+    const Float average = (lp + lq)*0.5f;
+    const Float angle = Math::abs(Math::dot(p, q))/(lp*lq);
+    const Float scale = 2.0f/(average/Math::min(lp, lq) + Math::max(lp, lq)/average);
+    const Float position = average/(average + ((p0 + p1) - (q0 + q1)).length()*0.5f);
+    if(angle*scale*position < CompatibilityThreshold) return 0.0f;
+    return angle*scale*position*Math::min(visibility(p0, p1, q0, q1), visibility(q0, q1, p0, p1));
+}
+
+}
+
+void EdgeBundles::build(const Containers::ArrayView<const Vector2> positions, const Containers::ArrayView<const Vector2ui> edges, UnsignedInt threadCount) {
+    if(!threadCount) threadCount = Math::max(std::thread::hardware_concurrency(), 1u);
+
+    const std::size_t count = edges.size();
+    arrayResize(_lengths, NoInit, count);
+    Float meanLength = 0.0f;
+    for(std::size_t i = 0; i != count; ++i) {
+        _lengths[i] = (positions[edges[i].y()] - positions[edges[i].x()]).length();
+        meanLength += _lengths[i];
+    }
+    if(count) meanLength /= count;
+
+    findCompatible(positions, edges, threadCount);
+
+    _pointsPerEdge = 0;
+
+    /* The threads are started once and run all cycles, waiting for each
+       other after every iteration. The last one is the calling thread,
+       which also does the serial parts between. Each follows the same
+       schedule on its own, so only the point arrays are shared. */
+    Barrier barrier{threadCount};
+    runThreads(threadCount, [&](const UnsignedInt thread) {
+        const bool leader = thread == threadCount - 1;
+        const std::pair<std::size_t, std::size_t> range = threadRange(count, threadCount, thread);
+        UnsignedInt innerCount = 1;
+        Float step = FirstStepSize*meanLength;
+        Float iterations = FirstIterationCount;
+        for(UnsignedInt cycle = 0; cycle != CycleCount; ++cycle) {
+            if(leader) {
+                subdivide(positions, edges, innerCount + 2);
+                arrayResize(_previous, NoInit, _points.size());
+            }
+            barrier.wait();
+            const UnsignedInt stride = _pointsPerEdge;
+            const UnsignedInt iterationCount = UnsignedInt(iterations);
+
+            for(UnsignedInt iteration = 0; iteration != iterationCount; ++iteration) {
+                /* Jacobi style, every edge reads only the previous iteration.
+                   The two arrays take turns instead of being swapped, so
+                   nothing needs to happen between iterations. */
+                const Vector2* const read = iteration % 2 ? _previous.data() : _points.data();
+                Vector2* const write = iteration % 2 ? _points.data() : _previous.data();
+                for(std::size_t e = range.first; e != range.second; ++e) {
+                    const Vector2* const previous = read + e*stride;
+                    Vector2* const points = write + e*stride;
+                    points[0] = previous[0];
+                    points[stride - 1] = previous[stride - 1];
+                    if(_lengths[e] < MinLength) {
+                        for(UnsignedInt i = 1; i != stride - 1; ++i)
+                            points[i] = previous[i];
+                        continue;
+                    }
+
+                    const Float spring = SpringConstant/(_lengths[e]*(stride - 1));
+                    const UnsignedInt* const compatible = _compatible + e*MaxCompatible;
+                    for(UnsignedInt i = 1; i != stride - 1; ++i) {
+                        const Vector2 p = previous[i];
+                        Vector2 force = spring*(previous[i - 1] + previous[i + 1] - 2.0f*p);
+                        for(UnsignedInt c = 0; c != _compatibleCounts[e]; ++c) {
+                            const UnsignedInt other = compatible[c] & ~Reversed;
+                            const UnsignedInt j = compatible[c] & Reversed ? stride - 1 - i : i;
+                            const Vector2 direction = read[std::size_t(other)*stride + j] - p;
+                            const Float distance = direction.length();
+                            if(distance > MinLength) force += direction/distance;
+                        }
+                        points[i] = p + step*force;
+                    }
+                }
+                barrier.wait();
+            }
+
+            /* Put the result where subdivide() and points() expect it */
+            if(leader && iterationCount % 2) std::swap(_points, _previous);
+            barrier.wait();
+
+            innerCount *= 2;
+            step *= 0.5f;
+            iterations *= IterationRate;
+        }
+    });
+}
+
+void EdgeBundles::findCompatible(const Containers::ArrayView<const Vector2> positions, const Containers::ArrayView<const Vector2ui> edges, const UnsignedInt threadCount) {
+    const std::size_t count = edges.size();
+    Containers::Array<Vector2> midpoints{NoInit, count};
+    for(std::size_t i = 0; i != count; ++i)
+        midpoints[i] = (positions[edges[i].x()] + positions[edges[i].y()])*0.5f;
+    SpatialGrid grid;
+    grid.build(midpoints);
+
+    arrayResize(_compatible, NoInit, count*MaxCompatible);
+    arrayResize(_compatibleCounts, NoInit, count);
+    parallelFor(count, threadCount, [&](const std::size_t begin, const std::size_t end) {
+        Containers::Array<UnsignedInt> candidates;
+        std::vector<std::pair<Float, UnsignedInt>> scored;
+        for(std::size_t e = begin; e != end; ++e) {
+            _compatibleCounts[e] = 0;
+            if(_lengths[e] < MinLength) continue;
+
+            const Vector2 p0 = positions[edges[e].x()];
+            const Vector2 p1 = positions[edges[e].y()];
+            grid.nearest(midpoints[e], CandidateCount, candidates);
+
+            scored.clear();
+            for(const UnsignedInt other: candidates) {
+                if(other == e || _lengths[other] < MinLength) continue;
+                const Vector2 q0 = positions[edges[other].x()];
+                const Vector2 q1 = positions[edges[other].y()];
+                const Float score = compatibility(p0, p1, q0, q1);
+                if(score < CompatibilityThreshold) continue;
+                scored.emplace_back(score, Math::dot(p1 - p0, q1 - q0) < 0.0f ? other|Reversed : other);
+            }
+
+            /* Keep the most compatible ones */
+            if(scored.size() > MaxCompatible) {
+                std::nth_element(scored.begin(), scored.begin() + MaxCompatible, scored.end(),
+                    [](const std::pair<Float, UnsignedInt>& a, const std::pair<Float, UnsignedInt>& b) {
+                        return a.first > b.first;
+                    });
+                scored.resize(MaxCompatible);
+            }
+            for(std::size_t i = 0; i != scored.size(); ++i)
+                _compatible[e*MaxCompatible + i] = scored[i].second;
+            _compatibleCounts[e] = scored.size();
+        }
+    });
+}
+
+void EdgeBundles::subdivide(const Containers::ArrayView<const Vector2> positions, const Containers::ArrayView<const Vector2ui> edges, const UnsignedInt pointsPerEdge) {
+    const std::size_t count = edges.size();
+    const UnsignedInt previousStride = _pointsPerEdge;
+    std::swap(_points, _previous);
+    arrayResize(_points, NoInit, count*pointsPerEdge);
+    _pointsPerEdge = pointsPerEdge;
+
+    for(std::size_t e = 0; e != count; ++e) {
+        Vector2* const points = _points + e*pointsPerEdge;
+
+        /* Straight line at first */
+        if(!previousStride) {
+            const Vector2 a = positions[edges[e].x()];
+            const Vector2 b = positions[edges[e].y()];
+            for(UnsignedInt i = 0; i != pointsPerEdge; ++i)
+                points[i] = Math::lerp(a, b, Float(i)/(pointsPerEdge - 1));
+            continue;
+        }
+
+        /* Otherwise equidistant points along the current polyline */
+        const Vector2* const previous = _previous + e*previousStride;
+        Float length = 0.0f;
+        for(UnsignedInt i = 0; i != previousStride - 1; ++i)
+            length += (previous[i + 1] - previous[i]).length();
+        const Float spacing = length/(pointsPerEdge - 1);
+
+        points[0] = previous[0];
+        points[pointsPerEdge - 1] = previous[previousStride - 1];
+        UnsignedInt segment = 0;
+        Float segmentStart = 0.0f;
+        Float segmentLength = (previous[1] - previous[0]).length();
+        for(UnsignedInt i = 1; i != pointsPerEdge - 1; ++i) {
+            const Float target = spacing*i;
+            while(segmentStart + segmentLength < target && segment + 2 < previousStride) {
+                segmentStart += segmentLength;
+                ++segment;
+                segmentLength = (previous[segment + 1] - previous[segment]).length();
+            }
+            const Float t = segmentLength > 0.0f ? Math::clamp((target - segmentStart)/segmentLength, 0.0f, 1.0f) : 0.0f;
+            points[i] = Math::lerp(previous[segment], previous[segment + 1], t);
+        }
+    }
+}
+
+}
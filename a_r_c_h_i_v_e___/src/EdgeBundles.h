@@ -0,0 +1,51 @@
+#ifndef EdgeBundles_h
+#define EdgeBundles_h
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector2.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Force-directed edge bundling, Holten and van Wijk 2009. Every edge is
+   subdivided into a polyline whose inner points are pulled towards the
+   matching points of compatible edges --- similar direction, length and
+   position, and roughly facing each other --- while a spring keeps the
+   polyline from drifting. The number of points doubles every cycle.
+
+   Compatible pairs are looked for among edges with nearby midpoints, found
+   through a SpatialGrid, and capped per edge, and
+   each iteration only reads the previous one, so edges are moved in
+   parallel without any locking. The result is one fixed-length strip per
+   edge, pointsPerEdge() points starting at edge index times that. */
+class EdgeBundles {
+    public:
+        /* Zero thread count picks one per hardware thread */
+        void build(Containers::ArrayView<const Vector2> positions, Containers::ArrayView<const Vector2ui> edges, UnsignedInt threadCount = 0);
+
+        std::size_t edgeCount() const { return _pointsPerEdge ? _points.size()/_pointsPerEdge : 0; }
+
+        /* Including both endpoints */
+        UnsignedInt pointsPerEdge() const { return _pointsPerEdge; }
+
+        Containers::ArrayView<const Vector2> points() const { return _points; }
+
+    private:
+        void findCompatible(Containers::ArrayView<const Vector2> positions, Containers::ArrayView<const Vector2ui> edges, UnsignedInt threadCount);
+        void subdivide(Containers::ArrayView<const Vector2> positions, Containers::ArrayView<const Vector2ui> edges, UnsignedInt pointsPerEdge);
+
+        UnsignedInt _pointsPerEdge{};
+        Containers::Array<Vector2> _points, _previous;
+        Containers::Array<Float> _lengths;
+
+        /* MaxCompatible slots per edge. Top bit set if the other edge goes
+           the opposite way and its points have to be walked backwards. */
+        Containers::Array<UnsignedInt> _compatible;
+        Containers::Array<UnsignedInt> _compatibleCounts;
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "EdgeGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Vector2.h>
+
+namespace Breadcrumbs {
+
+namespace {
+
+constexpr Float MinCellSize = 1.0f;
+constexpr Int MaxCellsPerSide = 1 << 15;
+
+/* Bounding boxes first, then whether all rectangle corners are on the same
+   side of the line */
+bool intersects(const Range2D& range, const Vector2& a, const Vector2& b) {
+    if((Math::max(a, b) < range.min()).any() || (Math::min(a, b) > range.max()).any())
+        return false;
+
+    const Vector2 direction = b - a;
+    const Float corners[]{
+        Math::cross(direction, range.bottomLeft() - a),
+        Math::cross(direction, range.bottomRight() - a),
+        Math::cross(direction, range.topLeft() - a),
+        Math::cross(direction, range.topRight() - a)
+    };
+    bool above = true, below = true;
+    for(const Float corner: corners) {
+        above = above && corner > 0.0f;
+        below = below && corner < 0.0f;
+    }
+    return !above && !below;
+}
+
+}
+
+void EdgeGrid::build(const Containers::ArrayView<const Vector2> positions, const Containers::ArrayView<const Vector2ui> edges) {
+    const std::size_t count = edges.size();
+    arrayResize(_ids, NoInit, count);
+    arrayResize(_segments, NoInit, count*2);
+    arrayResize(_cells, NoInit, count);
+
+    if(!count) {
+        _levelCount = 0;
+        arrayResize(_cellOffsets, ValueInit, 1);
+        return;
+    }
+
+    Vector2 min = positions[0], max = positions[0];
+    for(const Vector2& position: positions) {
+        min = Math::min(min, position);
+        max = Math::max(max, position);
+    }
+    _min = min;
+
+    /* Finest level has about one edge per cell, the coarsest a single cell */
+    const Vector2 size = Math::max(max - min, Vector2{MinCellSize});
+    Float cellSize = Math::max(std::sqrt(size.product()/count), MinCellSize);
+    UnsignedInt cellCount = 0;
+    for(_levelCount = 0; _levelCount != MaxLevelCount; cellSize *= 2.0f) {
+        Level& level = _levels[_levelCount++];
+        level.size = Math::clamp(Vector2i{Math::floor(size/cellSize)} + Vector2i{1}, Vector2i{1}, Vector2i{MaxCellsPerSide});
+        /* Grow the cells if the count got clamped so they still cover
+           everything, same as in SpatialGrid::build(). Coarser levels
+           double from there. */
+        level.cellSize = cellSize = Math::max(cellSize, (size/Vector2{level.size}).max());
+        level.offset = cellCount;
+        cellCount += level.size.product();
+        if(level.size == Vector2i{1}) break;
+    }
+
+    /* Counting sort over cells of all levels at once, same as in
+       SpatialGrid::build() */
+    arrayResize(_cellOffsets, NoInit, cellCount + 1);
+    std::fill(_cellOffsets.begin(), _cellOffsets.end(), 0u);
+    for(std::size_t i = 0; i != count; ++i) {
+        const Vector2 a = positions[edges[i].x()];
+        const Vector2 b = positions[edges[i].y()];
+        const Float extent = Math::abs(b - a).max();
+        UnsignedInt l = 0;
+        while(l + 1 != _levelCount && _levels[l].cellSize < extent) ++l;
+
+        const Level& level = _levels[l];
+        const Vector2i cell = Math::clamp(Vector2i{Math::floor(((a + b)*0.5f - min)/level.cellSize)}, Vector2i{0}, level.size - Vector2i{1});
+        _cells[i] = level.offset + cell.y()*level.size.x() + cell.x();
+        ++_cellOffsets[_cells[i] + 1];
+    }
+    for(std::size_t i = 1; i <= cellCount; ++i)
+        _cellOffsets[i] += _cellOffsets[i - 1];
+    for(std::size_t i = 0; i != count; ++i) {
+        const UnsignedInt to = _cellOffsets[_cells[i]]++;
+        _ids[to] = i;
+        _segments[to*2 + 0] = positions[edges[i].x()];
+        _segments[to*2 + 1] = positions[edges[i].y()];
+    }
+    for(std::size_t i = cellCount; i != 0; --i)
+        _cellOffsets[i] = _cellOffsets[i - 1];
+    _cellOffsets[0] = 0;
+}
+
+void EdgeGrid::within(const Range2D& range, Containers::Array<UnsignedInt>& out) const {
+    for(UnsignedInt l = 0; l != _levelCount; ++l) {
+        const Level& level = _levels[l];
+
+        /* Edges longer than the coarsest cell got clamped into it, so that
+           one is always searched whole */
+        Vector2i min{0}, max = level.size - Vector2i{1};
+        if(l + 1 != _levelCount) {
+            const Vector2 loose{level.cellSize*0.5f};
+            min = Math::clamp(Vector2i{Math::floor((range.min() - loose - _min)/level.cellSize)}, Vector2i{0}, max);
+            max = Math::clamp(Vector2i{Math::floor((range.max() + loose - _min)/level.cellSize)}, Vector2i{0}, max);
+        }
+
+        for(Int y = min.y(); y <= max.y(); ++y) {
+            const std::size_t row = level.offset + std::size_t(y)*level.size.x();
+            for(UnsignedInt i = _cellOffsets[row + min.x()]; i != _cellOffsets[row + max.x() + 1]; ++i)
+                if(intersects(range, _segments[i*2 + 0], _segments[i*2 + 1]))
+                    arrayAppend(out, _ids[i]);
+        }
+    }
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef EdgeGrid_h
+#define EdgeGrid_h
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Range.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Hierarchy of loose grids over edge segments, for culling. Each level has
+   cells twice the size of the previous one and an edge goes to the first
+   level where its bounding box fits in a cell, into the cell containing the
+   box center. The box then lies within the cell grown by half its size on
+   every side, so a query only needs to look at cells overlapping the query
+   range grown by that much at each level. Built with a single counting sort
+   over all levels in O(n), storage is reused across rebuilds. */
+class EdgeGrid {
+    public:
+        enum: UnsignedInt { MaxLevelCount = 24 };
+
+        explicit EdgeGrid() = default;
+
+        void build(Containers::ArrayView<const Vector2> positions, Containers::ArrayView<const Vector2ui> edges);
+
+        std::size_t edgeCount() const { return _ids.size(); }
+        UnsignedInt levelCount() const { return _levelCount; }
+
+        /* Appends all edges with their segment intersecting given rectangle
+           to out */
+        void within(const Range2D& range, Containers::Array<UnsignedInt>& out) const;
+
+    private:
+        struct Level {
+            Float cellSize;
+            Vector2i size;
+            /* Index of the first cell in _cellOffsets */
+            UnsignedInt offset;
+        };
+
+        Vector2 _min;
+        UnsignedInt _levelCount{};
+        Level _levels[MaxLevelCount];
+        Containers::Array<UnsignedInt> _cellOffsets;
+        Containers::Array<UnsignedInt> _ids;
+        /* Endpoint pairs in the same order as _ids */
+        Containers::Array<Vector2> _segments;
+        /* Cell of each edge, scratch space for build() */
+        Containers::Array<UnsignedInt> _cells;
+};
+
+}
+
+#endif
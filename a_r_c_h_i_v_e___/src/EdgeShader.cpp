@@ -0,0 +1,48 @@
+#include "EdgeShader.h"
+
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Containers/StringView.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Version.h>
+
+namespace Breadcrumbs {
+
+EdgeShader::EdgeShader() {
+    MAGNUM_ASSERT_GL_VERSION_SUPPORTED(GL::Version::GL330);
+
+    const Utility::Resource rs{"breadcrumbs-shaders"};
+    GL::Shader vert{GL::Version::GL330, GL::Shader::Type::Vertex};
+    GL::Shader frag{GL::Version::GL330, GL::Shader::Type::Fragment};
+    vert.addSource(rs.getString("EdgeShader.vert"));
+    frag.addSource(rs.getString("EdgeShader.frag"));
+    CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, frag}));
+    attachShaders({vert, frag});
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+    setUniformBlockBinding(uniformBlockIndex("TransformationProjection"), TransformationProjectionBufferBinding);
+    setUniformBlockBinding(uniformBlockIndex("Draw"), DrawBufferBinding);
+}
+
+EdgeShader& EdgeShader::bindTransformationProjectionBuffer(GL::Buffer& buffer) {
+    buffer.bind(GL::Buffer::Target::Uniform, TransformationProjectionBufferBinding);
+    return *this;
+}
+
+EdgeShader& EdgeShader::bindDrawBuffer(GL::Buffer& buffer) {
+    buffer.bind(GL::Buffer::Target::Uniform, DrawBufferBinding);
+    return *this;
+}
+
+GL::Mesh EdgeShader::mesh(GL::Buffer& instances) {
+    GL::Mesh mesh{GL::MeshPrimitive::TriangleStrip};
+    mesh.setCount(4)
+        .addVertexBufferInstanced(instances, 1, 0,
+            From{}, To{}, Width{}, instanceColor());
+    return mesh;
+}
+
+}
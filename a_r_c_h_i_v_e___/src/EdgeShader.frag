@@ -0,0 +1,17 @@
+uniform Draw {
+    highp vec2 viewportSize;
+    highp float smoothness;
+    highp float widthScale;
+};
+
+in lowp vec4 interpolatedColor;
+in highp float edgeDistance;
+flat in highp float halfWidth;
+
+out lowp vec4 fragmentColor;
+
+void main() {
+    /* Coverage falls off linearly over smoothness pixels around the edge */
+    lowp float coverage = clamp((halfWidth - abs(edgeDistance))/smoothness + 0.5, 0.0, 1.0);
+    fragmentColor = vec4(interpolatedColor.rgb, interpolatedColor.a*coverage);
+}
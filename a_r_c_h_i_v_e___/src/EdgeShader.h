@@ -0,0 +1,68 @@
+#ifndef EdgeShader_h
+#define EdgeShader_h
+
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Attribute.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Vector2.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Per-instance data of the edge quad, 24 bytes per edge */
+struct EdgeInstance {
+    Vector2 from, to;
+    /* In pixels */
+    Float width;
+    Color4ub color;
+};
+
+/* Contents of the draw uniform buffer */
+struct EdgeDrawUniform {
+    explicit EdgeDrawUniform(const Vector2& viewportSize): viewportSize{viewportSize} {}
+
+    Vector2 viewportSize;
+    /* Width of the anti-aliasing falloff, in pixels */
+    Float smoothness{1.0f};
+    /* Multiplies all instance widths */
+    Float widthScale{1.0f};
+};
+
+/* Anti-aliased edges of varying width. There's no vertex data, an edge is
+   one EdgeInstance, expanded to a quad in the vertex shader, so any number
+   of edges is a single instanced draw of a four-vertex triangle strip. The
+   transformation and projection come from a uniform buffer laid out like
+   Shaders::TransformationProjectionUniform2D, so the same buffer can feed
+   Shaders::FlatGL with uniform buffers enabled. */
+class EdgeShader: public GL::AbstractShaderProgram {
+    public:
+        typedef GL::Attribute<0, Vector2> From;
+        typedef GL::Attribute<1, Vector2> To;
+        typedef GL::Attribute<2, Float> Width;
+        typedef GL::Attribute<3, Vector4> Color;
+
+        enum: UnsignedInt {
+            TransformationProjectionBufferBinding = 1,
+            DrawBufferBinding = 2
+        };
+
+        explicit EdgeShader();
+        explicit EdgeShader(NoCreateT) noexcept: GL::AbstractShaderProgram{NoCreate} {}
+
+        EdgeShader& bindTransformationProjectionBuffer(GL::Buffer& buffer);
+        EdgeShader& bindDrawBuffer(GL::Buffer& buffer);
+
+        /* Attributes of EdgeInstance, to pass to addVertexBufferInstanced() */
+        static Color instanceColor() {
+            return Color{Color::Components::Four, Color::DataType::UnsignedByte, Color::DataOption::Normalized};
+        }
+
+        /* A mesh drawing instances from given buffer, set its instance count
+           to the number of edges */
+        static GL::Mesh mesh(GL::Buffer& instances);
+};
+
+}
+
+#endif
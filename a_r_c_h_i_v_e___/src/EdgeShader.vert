@@ -0,0 +1,47 @@
+/* One instance per edge, expanded from gl_VertexID to a quad along the
+   segment. Corners 0 and 1 are at the start, 2 and 3 at the end, odd ones on
+   the left side, which makes a triangle strip. Widths are in pixels so they
+   stay readable at any zoom. */
+
+uniform TransformationProjection {
+    highp mat3x4 transformationProjectionMatrix;
+};
+
+uniform Draw {
+    highp vec2 viewportSize;
+    highp float smoothness;
+    highp float widthScale;
+};
+
+layout(location = 0) in highp vec2 from;
+layout(location = 1) in highp vec2 to;
+layout(location = 2) in highp float width;
+layout(location = 3) in lowp vec4 color;
+
+out lowp vec4 interpolatedColor;
+/* Signed distance from the center line, in pixels */
+out highp float edgeDistance;
+flat out highp float halfWidth;
+
+void main() {
+    highp vec2 a = (mat3(transformationProjectionMatrix)*vec3(from, 1.0)).xy*viewportSize*0.5;
+    highp vec2 b = (mat3(transformationProjectionMatrix)*vec3(to, 1.0)).xy*viewportSize*0.5;
+    highp vec2 direction = b - a;
+    highp float segmentLength = length(direction);
+    direction = segmentLength > 0.0 ? direction/segmentLength : vec2(1.0, 0.0);
+    highp vec2 normal = vec2(-direction.y, direction.x);
+
+    /* Lines thinner than a pixel are drawn a pixel wide and fainter
+       instead, and the quad grows by the smoothing falloff on all sides */
+    highp float scaledWidth = width*widthScale;
+    halfWidth = max(scaledWidth, 1.0)*0.5;
+    highp float extent = halfWidth + smoothness;
+    highp float side = (gl_VertexID & 1) == 0 ? -1.0 : 1.0;
+    highp vec2 position = (gl_VertexID & 2) == 0 ?
+        a - direction*smoothness : b + direction*smoothness;
+    position += normal*side*extent;
+
+    gl_Position = vec4(position*2.0/viewportSize, 0.0, 1.0);
+    edgeDistance = side*extent;
+    interpolatedColor = vec4(color.rgb, color.a*min(scaledWidth, 1.0));
+}
@@ -0,0 +1,29 @@
+#ifndef ForceBackend_h
+#define ForceBackend_h
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector2.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Alternative implementation of the two expensive ForceLayout passes, the
+   many-body charge and the link spring. It gets the layout state arrays
+   as-is and has to add to velocities what ForceLayout::step() would, the
+   rest of the tick stays on the CPU. Links and their strengths are fixed for
+   the lifetime of a layout, so an implementation takes them once on
+   construction. */
+class ForceBackend {
+    public:
+        virtual ~ForceBackend() = default;
+
+        virtual const char* name() const = 0;
+
+        virtual void apply(Containers::ArrayView<const Vector2> positions, Containers::ArrayView<Vector2> velocities, Float alpha) = 0;
+};
+
+}
+
+#endif
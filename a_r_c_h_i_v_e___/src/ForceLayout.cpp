@@ -0,0 +1,242 @@
+#include "ForceLayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Magnum/Math/Functions.h>
+
+namespace Breadcrumbs {
+
+namespace {
+
+/* Tiny deterministic nudge for coincident nodes, like jiggle() in d3 */
+Float jiggle(UnsignedInt& state) {
+    state = state*1664525u + 1013904223u;
+    return (Float(state >> 8)/Float(1 << 24) - 0.5f)*1.0e-6f;
+}
+
+/* The d3 phyllotaxis arrangement used for nodes without a position */
+constexpr Float InitialRadius = 10.0f;
+const Float InitialAngle = Constants::pi()*(3.0f - std::sqrt(5.0f));
+
+}
+
+constexpr Float ForceLayout::AlphaMin;
+constexpr Float ForceLayout::VelocityDecay;
+constexpr Float ForceLayout::ChargeStrength;
+constexpr Float ForceLayout::LinkDistance;
+constexpr Float ForceLayout::CenterStrength;
+
+ForceLayout::ForceLayout(const std::size_t nodeCount, const Containers::ArrayView<const Vector2ui> links):
+    _positions{NoInit, nodeCount},
+    _velocities{ValueInit, nodeCount},
+    _pins{ValueInit, nodeCount},
+    _pinned{ValueInit, nodeCount},
+    _links{NoInit, links.size()},
+    _linkStrengths{NoInit, links.size()},
+    _linkBiases{NoInit, links.size()},
+    _order{NoInit, nodeCount},
+    _alphaDecay{1.0f - std::pow(AlphaMin, 1.0f/300.0f)}
+{
+    for(std::size_t i = 0; i != nodeCount; ++i) {
+        const Float radius = InitialRadius*std::sqrt(0.5f + i);
+        const Float angle = i*InitialAngle;
+        _positions[i] = {radius*std::cos(angle), radius*std::sin(angle)};
+    }
+
+    /* Link strength and bias depend on the degree, same as in forceLink() */
+    Containers::Array<UnsignedInt> degrees{ValueInit, nodeCount};
+    for(const Vector2ui& link: links) {
+        ++degrees[link.x()];
+        ++degrees[link.y()];
+    }
+    for(std::size_t i = 0; i != links.size(); ++i) {
+        const UnsignedInt source = degrees[links[i].x()];
+        const UnsignedInt target = degrees[links[i].y()];
+        _links[i] = links[i];
+        _linkStrengths[i] = 1.0f/Math::min(source, target);
+        _linkBiases[i] = Float(source)/(source + target);
+    }
+}
+
+ForceLayout& ForceLayout::setPositions(const Containers::ArrayView<const Vector2> positions) {
+    Utility::copy(positions, _positions);
+    std::fill(_velocities.begin(), _velocities.end(), Vector2{});
+    return *this;
+}
+
+void ForceLayout::pin(const UnsignedInt node, const Vector2& position) {
+    _pins[node] = position;
+    _pinned[node] = true;
+}
+
+void ForceLayout::unpin(const UnsignedInt node) {
+    _pinned[node] = false;
+}
+
+bool ForceLayout::step() {
+    _alpha += (_alphaTarget - _alpha)*_alphaDecay;
+
+    if(_backend) _backend->apply(_positions, _velocities, _alpha);
+    else {
+        applyCharge();
+        applyLinks();
+    }
+    applyCenter();
+
+    for(std::size_t i = 0; i != _positions.size(); ++i) {
+        if(_pinned[i]) {
+            _positions[i] = _pins[i];
+            _velocities[i] = {};
+        } else {
+            _velocities[i] *= 1.0f - VelocityDecay;
+            _positions[i] += _velocities[i];
+        }
+    }
+
+    return isActive();
+}
+
+Int ForceLayout::buildQuadNode(const UnsignedInt begin, const UnsignedInt end, const Vector2& min, const Float size, const UnsignedInt depth) {
+    const Int index = _quadNodes.size();
+    {
+        QuadNode& node = arrayAppend(_quadNodes, InPlaceInit);
+        node.size = size;
+        node.first = begin;
+        node.last = end;
+        for(Int& child: node.children) child = -1;
+    }
+
+    /* Leaf, or a stack of coincident points that can't be split further */
+    if(end - begin <= 1 || depth == 32) {
+        Vector2 center;
+        for(UnsignedInt i = begin; i != end; ++i)
+            center += _positions[_order[i]];
+        _quadNodes[index].center = center/Float(end - begin);
+        _quadNodes[index].strength = ChargeStrength*(end - begin);
+        return index;
+    }
+
+    const Float half = size*0.5f;
+    const Vector2 mid = min + Vector2{half};
+    UnsignedInt* const first = _order.data() + begin;
+    UnsignedInt* const last = _order.data() + end;
+    UnsignedInt* const splitX = std::partition(first, last, [&](UnsignedInt i) {
+        return _positions[i].x() < mid.x();
+    });
+    UnsignedInt* const splits[5]{
+        first,
+        std::partition(first, splitX, [&](UnsignedInt i) {
+            return _positions[i].y() < mid.y();
+        }),
+        splitX,
+        std::partition(splitX, last, [&](UnsignedInt i) {
+            return _positions[i].y() < mid.y();
+        }),
+        last
+    };
+    /* Quadrant order matching the partitioning above */
+    const Vector2 offsets[4]{{0.0f, 0.0f}, {0.0f, half}, {half, 0.0f}, {half, half}};
+
+    Vector2 center;
+    Float strength = 0.0f;
+    for(std::size_t i = 0; i != 4; ++i) {
+        if(splits[i] == splits[i + 1]) continue;
+        const Int child = buildQuadNode(splits[i] - _order.data(), splits[i + 1] - _order.data(), min + offsets[i], half, depth + 1);
+        /* Not holding a reference across the recursion, the array may get
+           reallocated */
+        _quadNodes[index].children[i] = child;
+        center += _quadNodes[child].center*_quadNodes[child].strength;
+        strength += _quadNodes[child].strength;
+    }
+    _quadNodes[index].center = center/strength;
+    _quadNodes[index].strength = strength;
+    return index;
+}
+
+void ForceLayout::buildQuadtree() {
+    arrayResize(_quadNodes, NoInit, 0);
+    if(_positions.isEmpty()) return;
+
+    Vector2 min = _positions[0], max = _positions[0];
+    for(std::size_t i = 0; i != _positions.size(); ++i) {
+        _order[i] = i;
+        min = Math::min(min, _positions[i]);
+        max = Math::max(max, _positions[i]);
+    }
+
+    /* Square cells so the opening criterion is isotropic */
+    buildQuadNode(0, _positions.size(), min, Math::max((max - min).max(), 1.0f), 0);
+}
+
+void ForceLayout::applyCharge() {
+    buildQuadtree();
+    if(_quadNodes.isEmpty()) return;
+
+    const Float theta2 = _theta*_theta;
+    UnsignedInt seed = 0;
+    Int stack[32*3 + 4];
+    for(std::size_t i = 0; i != _positions.size(); ++i) {
+        const Vector2 position = _positions[i];
+        Vector2 velocity;
+
+        std::size_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while(stackSize) {
+            const QuadNode& node = _quadNodes[stack[--stackSize]];
+
+            /* Far enough to be treated as a single body */
+            Vector2 delta = node.center - position;
+            Float distance2 = delta.dot();
+            if(node.size*node.size < theta2*distance2) {
+                if(distance2 < 1.0f) distance2 = std::sqrt(distance2);
+                velocity += delta*node.strength*_alpha/distance2;
+                continue;
+            }
+
+            bool leaf = true;
+            for(const Int child: node.children) if(child != -1) {
+                stack[stackSize++] = child;
+                leaf = false;
+            }
+            if(!leaf) continue;
+
+            for(UnsignedInt j = node.first; j != node.last; ++j) {
+                const UnsignedInt other = _order[j];
+                if(other == i) continue;
+                delta = _positions[other] - position;
+                if(delta.x() == 0.0f) delta.x() = jiggle(seed);
+                if(delta.y() == 0.0f) delta.y() = jiggle(seed);
+                distance2 = delta.dot();
+                if(distance2 < 1.0f) distance2 = std::sqrt(distance2);
+                velocity += delta*ChargeStrength*_alpha/distance2;
+            }
+        }
+
+        _velocities[i] += velocity;
+    }
+}
+
+void ForceLayout::applyLinks() {
+    UnsignedInt seed = 1;
+    for(std::size_t i = 0; i != _links.size(); ++i) {
+        const UnsignedInt source = _links[i].x();
+        const UnsignedInt target = _links[i].y();
+        Vector2 delta = _positions[target] + _velocities[target] - _positions[source] - _velocities[source];
+        if(delta.x() == 0.0f) delta.x() = jiggle(seed);
+        if(delta.y() == 0.0f) delta.y() = jiggle(seed);
+        const Float length = delta.length();
+        delta *= (length - LinkDistance)/length*_alpha*_linkStrengths[i];
+        _velocities[target] -= delta*_linkBiases[i];
+        _velocities[source] += delta*(1.0f - _linkBiases[i]);
+    }
+}
+
+void ForceLayout::applyCenter() {
+    const Float strength = CenterStrength*_alpha;
+    for(std::size_t i = 0; i != _positions.size(); ++i)
+        _velocities[i] -= _positions[i]*strength;
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef ForceLayout_h
+#define ForceLayout_h
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector2.h>
+
+#include "ForceBackend.h"
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Force-directed layout equivalent to the d3.forceSimulation() setup in
+   graph.js --- a Barnes-Hut many-body charge, a link spring, and forceX /
+   forceY pulling everything towards the origin. State is kept as separate
+   tightly packed arrays so a whole pass touches only what it needs. */
+class ForceLayout {
+    public:
+        explicit ForceLayout(std::size_t nodeCount, Containers::ArrayView<const Vector2ui> links);
+
+        std::size_t nodeCount() const { return _positions.size(); }
+
+        Containers::ArrayView<const Vector2> positions() const { return _positions; }
+        Containers::ArrayView<const Vector2> velocities() const { return _velocities; }
+        Containers::ArrayView<const Vector2ui> links() const { return _links; }
+        Containers::ArrayView<const Float> linkStrengths() const { return _linkStrengths; }
+        Containers::ArrayView<const Float> linkBiases() const { return _linkBiases; }
+
+        /* Charge and link passes are done by given backend instead of here
+           if set, null switches back. A backend computes the charge
+           exactly, theta has no effect then. */
+        ForceBackend* backend() { return _backend.get(); }
+        ForceLayout& setBackend(Containers::Pointer<ForceBackend>&& backend) {
+            _backend = std::move(backend);
+            return *this;
+        }
+
+        /* Replaces the initial arrangement, for example with a cached one.
+           Velocities are reset. */
+        ForceLayout& setPositions(Containers::ArrayView<const Vector2> positions);
+
+        Float alpha() const { return _alpha; }
+        ForceLayout& setAlpha(Float alpha) {
+            _alpha = alpha;
+            return *this;
+        }
+
+        Float alphaTarget() const { return _alphaTarget; }
+        ForceLayout& setAlphaTarget(Float target) {
+            _alphaTarget = target;
+            return *this;
+        }
+
+        /* Barnes-Hut opening angle. 0 makes the charge force exact. */
+        Float theta() const { return _theta; }
+        ForceLayout& setTheta(Float theta) {
+            _theta = theta;
+            return *this;
+        }
+
+        /* Same as assigning fx / fy in d3 */
+        void pin(UnsignedInt node, const Vector2& position);
+        void unpin(UnsignedInt node);
+        bool isPinned(UnsignedInt node) const { return _pinned[node]; }
+
+        /* Whether another step() would still move anything */
+        bool isActive() const { return _alpha >= AlphaMin || _alphaTarget > 0.0f; }
+
+        /* One simulation tick. Returns false if the layout has cooled down. */
+        bool step();
+
+        static constexpr Float AlphaMin = 0.001f;
+        static constexpr Float VelocityDecay = 0.4f;
+        static constexpr Float ChargeStrength = -30.0f;
+        static constexpr Float LinkDistance = 30.0f;
+        static constexpr Float CenterStrength = 0.1f;
+
+    private:
+        struct QuadNode {
+            Vector2 center;
+            Float strength;
+            Float size;
+            /* -1 for empty quadrants, all four -1 for a leaf */
+            Int children[4];
+            /* Range in _order covered by this subtree */
+            UnsignedInt first, last;
+        };
+
+        void applyCharge();
+        void applyLinks();
+        void applyCenter();
+        void buildQuadtree();
+        Int buildQuadNode(UnsignedInt begin, UnsignedInt end, const Vector2& min, Float size, UnsignedInt depth);
+
+        Containers::Array<Vector2> _positions, _velocities, _pins;
+        Containers::Array<bool> _pinned;
+        Containers::Array<Vector2ui> _links;
+        Containers::Array<Float> _linkStrengths, _linkBiases;
+
+        /* Barnes-Hut scratch space, reused across ticks */
+        Containers::Array<UnsignedInt> _order;
+        Containers::Array<QuadNode> _quadNodes;
+
+        Containers::Pointer<ForceBackend> _backend;
+
+        Float _alpha{1.0f}, _alphaTarget{0.0f}, _theta{0.9f};
+        Float _alphaDecay;
+};
+
+}
+
+#endif
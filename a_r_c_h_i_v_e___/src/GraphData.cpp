@@ -0,0 +1,66 @@
+#include "GraphData.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/StringStl.h>
+
+#include "wgraph.h"
+
+namespace Breadcrumbs {
+
+Containers::StringView linkDomain(const std::string& link) {
+    /* Plain scans, this runs for every visit when sketching */
+    const char* begin = link.data();
+    const char* const end = begin + link.size();
+    for(const char* c = begin; c + 3 <= end; ++c) if(c[0] == ':' && c[1] == '/' && c[2] == '/') {
+        begin = c + 3;
+        break;
+    }
+    const char* c = begin;
+    while(c != end && *c != '/' && *c != '?' && *c != '#' && *c != ':') ++c;
+    return {begin, std::size_t(c - begin)};
+}
+
+GraphData graphDataFromWgraph(const Wgraph& graph) {
+    GraphData out;
+
+    const std::map<std::string, Node*>& nodes = graph.nodes();
+    std::unordered_map<const Node*, UnsignedInt> ids;
+    ids.reserve(nodes.size());
+    out.tags.reserve(nodes.size());
+    out.links.reserve(nodes.size());
+    out.groups = Containers::Array<UnsignedInt>{NoInit, nodes.size()};
+
+    std::unordered_map<std::string, UnsignedInt> domains;
+    for(const std::pair<const std::string, Node*>& i: nodes) {
+        const UnsignedInt id = out.tags.size();
+        ids.emplace(i.second, id);
+        out.tags.push_back(i.first);
+        out.links.push_back(i.second->link);
+        out.groups[id] = domains.emplace(linkDomain(i.second->link), domains.size()).first->second;
+    }
+
+    /* Node::adj contains one entry per connect() call in both directions, so
+       count each unordered pair from its lower end only */
+    std::map<std::pair<UnsignedInt, UnsignedInt>, UnsignedInt> weights;
+    for(const std::pair<const std::string, Node*>& i: nodes) {
+        const UnsignedInt a = ids.at(i.second);
+        for(const Node* adjacent: i.second->adj) {
+            const UnsignedInt b = ids.at(adjacent);
+            if(a < b) ++weights[{a, b}];
+        }
+    }
+
+    arrayReserve(out.edges, weights.size());
+    arrayReserve(out.edgeWeights, weights.size());
+    for(const std::pair<const std::pair<UnsignedInt, UnsignedInt>, UnsignedInt>& i: weights) {
+        arrayAppend(out.edges, Vector2ui{i.first.first, i.first.second});
+        arrayAppend(out.edgeWeights, i.second);
+    }
+
+    return out;
+}
+
+}
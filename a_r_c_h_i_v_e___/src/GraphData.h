@@ -0,0 +1,40 @@
+#ifndef GraphData_h
+#define GraphData_h
+
+#include <string>
+#include <vector>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/StringView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector2.h>
+
+class Wgraph;
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Flat, index-based snapshot of a Wgraph as consumed by the viewer. Node IDs
+   are positions in Wgraph::nodes() iteration order, links are deduplicated
+   and undirected, with the weight being how many times the pair was
+   connected. */
+struct GraphData {
+    std::vector<std::string> tags;
+    std::vector<std::string> links;
+    /* Index of the link domain, used for coloring */
+    Containers::Array<UnsignedInt> groups;
+    Containers::Array<Vector2ui> edges;
+    Containers::Array<UnsignedInt> edgeWeights;
+
+    std::size_t nodeCount() const { return tags.size(); }
+};
+
+GraphData graphDataFromWgraph(const Wgraph& graph);
+
+/* Host part of a link, with the scheme, port, path, query and fragment
+   stripped. Points into the link. */
+Containers::StringView linkDomain(const std::string& link);
+
+}
+
+#endif
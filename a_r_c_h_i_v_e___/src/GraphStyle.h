@@ -0,0 +1,52 @@
+#ifndef GraphStyle_h
+#define GraphStyle_h
+
+#include <cmath>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix3.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+using namespace Math::Literals;
+
+/* Same as radius in graph.js */
+constexpr Float NodeRadius = 4.0f;
+
+/* d3.schemeCategory10 */
+const Color3 Category10[]{
+    0x1f77b4_rgbf, 0xff7f0e_rgbf, 0x2ca02c_rgbf, 0xd62728_rgbf, 0x9467bd_rgbf,
+    0x8c564b_rgbf, 0xe377c2_rgbf, 0x7f7f7f_rgbf, 0xbcbd22_rgbf, 0x17becf_rgbf
+};
+
+inline Color3 groupColor(UnsignedInt group) {
+    return Category10[group % (sizeof(Category10)/sizeof(Category10[0]))];
+}
+
+const Color3 BackgroundColor = 0x202023_rgbf;
+
+/* lineStyle(1, 0x999999, 0.6) in graph.js */
+const Color4 EdgeColor{0x999999_rgbf, 0.6f};
+/* Edges touching a selected node */
+const Color4 SelectedEdgeColor{0xffffff_rgbf, 0.8f};
+
+/* Edge width in pixels encodes the visit count, one pixel for a single visit
+   and a pixel more for every doubling */
+constexpr Float MaxEdgeWidth = 6.0f;
+inline Float edgeWidth(UnsignedInt visits) {
+    return Math::min(1.0f + std::log2(Float(Math::max(visits, 1u))), MaxEdgeWidth);
+}
+
+/* Per-instance data of the node circle mesh */
+struct NodeInstance {
+    Matrix3 transformation;
+    Color3 color;
+    /* Node ID plus one, for ObjectIdPicker */
+    UnsignedInt objectId;
+};
+
+}
+
+#endif
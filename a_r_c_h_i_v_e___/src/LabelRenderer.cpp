@@ -0,0 +1,166 @@
+#include "LabelRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Text/AbstractFont.h>
+
+namespace Breadcrumbs {
+
+using namespace Math::Literals;
+
+namespace {
+
+/* Labels beyond this many are not worth the screen space anyway */
+constexpr std::size_t MaxLabels = 4096;
+
+/* Resolution of the occupancy grid used for collision tests, in pixels */
+constexpr Float CollisionCell = 4.0f;
+
+/* Zoom buckets per doubling of the zoom */
+constexpr Float ZoomBucketsPerOctave = 4.0f;
+
+/* Distance from the node center to the start of the label, in label
+   heights */
+constexpr Float LabelOffset = 0.75f;
+
+}
+
+LabelRenderer::LabelRenderer(Text::AbstractFont& font, const std::size_t nodeCount): _font(font), _cache{Vector2i{2048}, Vector2i{512}, 22}, _indexBuffer{GL::Buffer::TargetHint::ElementArray} {
+    /* Printable ASCII, and µ for the profiler overlay */
+    _font.fillGlyphCache(_cache,
+        " !\"#$%&'()*+,-./0123456789:;<=>?@"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
+        "abcdefghijklmnopqrstuvwxyz{|}~"
+        "µ");
+
+    _widths = Containers::Array<Float>{NoInit, nodeCount};
+    std::fill(_widths.begin(), _widths.end(), Constants::nan());
+
+    _mesh.addVertexBuffer(_vertexBuffer, 0,
+            Shaders::DistanceFieldVectorGL2D::Position{},
+            Shaders::DistanceFieldVectorGL2D::TextureCoordinates{})
+        .setIndexBuffer(_indexBuffer, 0, GL::MeshIndexType::UnsignedInt);
+
+    _shader.setColor(0xffffff_rgbf)
+        .setOutlineColor(0x202023_rgbf)
+        .setOutlineRange(0.5f, 0.3f)
+        .bindVectorTexture(_cache.texture());
+    setSize(_size);
+}
+
+LabelRenderer& LabelRenderer::setSize(const Float size) {
+    _size = size;
+    /* Smaller text needs a wider smoothstep to not alias */
+    _shader.setSmoothness(Math::clamp(0.6f/size, 0.025f, 0.2f));
+    _signature = 0;
+    return *this;
+}
+
+bool LabelRenderer::update(const Containers::ArrayView<const UnsignedInt> candidates, const Containers::ArrayView<const Vector2> positions, const std::vector<std::string>& tags, const Containers::ArrayView<const UnsignedInt> priorities, const Range2D& visible, const Float zoom, const UnsignedLong tick) {
+    const Float bucket = std::round(std::log2(zoom)*ZoomBucketsPerOctave);
+
+    /* FNV-1a over everything the labels depend on */
+    UnsignedLong signature = 0xcbf29ce484222325ull;
+    const auto hash = [&signature](const UnsignedLong value) {
+        signature = (signature ^ value)*0x100000001b3ull;
+    };
+    hash(tick);
+    hash(UnsignedLong(Long(bucket)));
+    for(const UnsignedInt id: candidates) hash(id);
+    if(signature == _signature) return false;
+    _signature = signature;
+
+    /* Size in world units, matching the requested pixel size at the bucket
+       center */
+    const Float height = _size/std::pow(2.0f, bucket/ZoomBucketsPerOctave);
+
+    arrayResize(_order, NoInit, 0);
+    arrayAppend(_order, candidates);
+    std::stable_sort(_order.begin(), _order.end(), [&](UnsignedInt a, UnsignedInt b) {
+        return priorities[a] > priorities[b];
+    });
+
+    const Vector2i gridSize = Vector2i{visible.size()*zoom/CollisionCell} + Vector2i{1};
+    arrayResize(_occupied, NoInit, std::size_t(gridSize.product()));
+    std::fill(_occupied.begin(), _occupied.end(), false);
+
+    arrayResize(_vertices, NoInit, 0);
+    arrayResize(_indices, NoInit, 0);
+    _labelCount = 0;
+    for(const UnsignedInt id: _order) {
+        if(_labelCount == MaxLabels) break;
+        const std::string& tag = tags[id];
+        if(tag.empty()) continue;
+
+        /* Advance at unit size, so rejected labels don't need a layout next
+           time */
+        if(_widths[id] != _widths[id]) {
+            Containers::Pointer<Text::AbstractLayouter> layouter = _font.layout(_cache, 1.0f, tag);
+            Vector2 cursor;
+            Range2D rectangle;
+            for(UnsignedInt i = 0; i != layouter->glyphCount(); ++i)
+                layouter->renderGlyph(i, cursor, rectangle);
+            _widths[id] = cursor.x();
+        }
+
+        /* Left edge at an offset from the node, vertically centered */
+        const Vector2 origin = positions[id] + Vector2{LabelOffset*height, -0.5f*height};
+        const Range2D rectangle = Range2D::fromSize(origin, {_widths[id]*height, height});
+
+        const Vector2i min = Vector2i{Math::floor((rectangle.min() - visible.min())*zoom/CollisionCell)};
+        const Vector2i max = Vector2i{Math::floor((rectangle.max() - visible.min())*zoom/CollisionCell)};
+        if((max < Vector2i{0}).any() || (min >= gridSize).any()) continue;
+        const Vector2i clampedMin = Math::max(min, Vector2i{0});
+        const Vector2i clampedMax = Math::min(max, gridSize - Vector2i{1});
+
+        bool free = true;
+        for(Int y = clampedMin.y(); free && y <= clampedMax.y(); ++y)
+            for(Int x = clampedMin.x(); x <= clampedMax.x(); ++x)
+                if(_occupied[std::size_t(y)*gridSize.x() + x]) {
+                    free = false;
+                    break;
+                }
+        if(!free) continue;
+        for(Int y = clampedMin.y(); y <= clampedMax.y(); ++y)
+            for(Int x = clampedMin.x(); x <= clampedMax.x(); ++x)
+                _occupied[std::size_t(y)*gridSize.x() + x] = true;
+
+        /* Glyph quads with the baseline a bit below the node center. Index
+           order is the same as in Text::Renderer. */
+        Containers::Pointer<Text::AbstractLayouter> layouter = _font.layout(_cache, height, tag);
+        Vector2 cursor = origin + Vector2::yAxis(0.2f*height);
+        Range2D bounds;
+        for(UnsignedInt i = 0; i != layouter->glyphCount(); ++i) {
+            const std::pair<Range2D, Range2D> quad = layouter->renderGlyph(i, cursor, bounds);
+            const UnsignedInt first = _vertices.size();
+            arrayAppend(_vertices, {
+                Vertex{quad.first.topLeft(), quad.second.topLeft()},
+                Vertex{quad.first.bottomLeft(), quad.second.bottomLeft()},
+                Vertex{quad.first.topRight(), quad.second.topRight()},
+                Vertex{quad.first.bottomRight(), quad.second.bottomRight()}
+            });
+            arrayAppend(_indices, {
+                first, first + 1, first + 2,
+                first + 1, first + 3, first + 2
+            });
+        }
+        ++_labelCount;
+    }
+
+    _vertexBuffer.setData(_vertices, GL::BufferUsage::DynamicDraw);
+    _indexBuffer.setData(_indices, GL::BufferUsage::DynamicDraw);
+    _mesh.setCount(_indices.size());
+    return true;
+}
+
+void LabelRenderer::draw(const Matrix3& transformationProjection) {
+    if(!_mesh.count()) return;
+    _shader.setTransformationProjectionMatrix(transformationProjection)
+        .draw(_mesh);
+}
+
+}
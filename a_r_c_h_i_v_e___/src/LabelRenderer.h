@@ -0,0 +1,87 @@
+#ifndef LabelRenderer_h
+#define LabelRenderer_h
+
+#include <string>
+#include <vector>
+#include <Corrade/Containers/Array.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Shaders/DistanceFieldVectorGL.h>
+#include <Magnum/Text/DistanceFieldGlyphCache.h>
+#include <Magnum/Text/Text.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Node tags drawn next to the nodes. All labels share one distance field
+   glyph cache and go into a single vertex and index buffer, drawn in one
+   call. Labels are placed greedily in priority order and skipped if they
+   would overlap an already placed one on screen.
+
+   Label size is constant on screen, so it depends on the zoom. To not
+   rebuild on every scroll step the zoom is quantized into buckets, within a
+   bucket labels scale together with the graph. */
+class LabelRenderer {
+    public:
+        /* The font is expected to stay alive for the whole lifetime of the
+           renderer */
+        explicit LabelRenderer(Text::AbstractFont& font, std::size_t nodeCount);
+
+        LabelRenderer(const LabelRenderer&) = delete;
+        LabelRenderer& operator=(const LabelRenderer&) = delete;
+
+        /* Label height in pixels */
+        Float size() const { return _size; }
+        LabelRenderer& setSize(Float size);
+
+        std::size_t labelCount() const { return _labelCount; }
+
+        /* Size of the vertex and index data uploaded by the last rebuild */
+        std::size_t dataSize() const {
+            return _vertices.size()*sizeof(Vertex) + _indices.size()*sizeof(UnsignedInt);
+        }
+
+        /* For drawing other text with the same font */
+        Text::DistanceFieldGlyphCache& glyphCache() { return _cache; }
+
+        /* Places labels for given candidate nodes inside the visible range,
+           higher priority first. Does nothing if neither the candidates, the
+           zoom bucket nor the tick changed since the last call. Returns true
+           if the labels were rebuilt. */
+        bool update(Containers::ArrayView<const UnsignedInt> candidates, Containers::ArrayView<const Vector2> positions, const std::vector<std::string>& tags, Containers::ArrayView<const UnsignedInt> priorities, const Range2D& visible, Float zoom, UnsignedLong tick);
+
+        void draw(const Matrix3& transformationProjection);
+
+    private:
+        struct Vertex {
+            Vector2 position;
+            Vector2 textureCoordinates;
+        };
+
+        Text::AbstractFont& _font;
+        Text::DistanceFieldGlyphCache _cache;
+        Shaders::DistanceFieldVectorGL2D _shader;
+        GL::Buffer _vertexBuffer, _indexBuffer;
+        GL::Mesh _mesh;
+        Float _size{12.0f};
+        std::size_t _labelCount{};
+
+        /* What the current labels were built from */
+        UnsignedLong _signature{};
+
+        /* Label width at unit size, measured on first use, NaN if not yet */
+        Containers::Array<Float> _widths;
+
+        /* Scratch space */
+        Containers::Array<UnsignedInt> _order;
+        Containers::Array<bool> _occupied;
+        Containers::Array<Vertex> _vertices;
+        Containers::Array<UnsignedInt> _indices;
+};
+
+}
+
+#endif
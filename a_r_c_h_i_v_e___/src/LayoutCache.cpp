@@ -0,0 +1,183 @@
+#include "LayoutCache.h"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/StringStl.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Corrade/Utility/DebugStl.h>
+#include <Corrade/Utility/MurmurHash2.h>
+#include <Corrade/Utility/Path.h>
+#include <Magnum/Math/Constants.h>
+#include <Magnum/Math/Functions.h>
+
+#include "ForceLayout.h"
+#include "GraphData.h"
+
+namespace Breadcrumbs {
+
+namespace {
+
+/* Native endianness, it's a local cache */
+constexpr char Magic[]{'B', 'C', 'L', '1'};
+
+/* A cached layout of the same graph has settled already, so it gets a
+   single tick. With new nodes it has to make room for them, but not
+   rearrange everything, so the alpha grows with the fraction of new nodes
+   up to this. */
+constexpr Float PartialAlpha = 0.3f;
+
+/* New nodes go around the average of their placed neighbours, on a golden
+   angle spiral so siblings don't coincide */
+constexpr Float NeighbourOffset = ForceLayout::LinkDistance*0.5f;
+const Float NeighbourAngle = Constants::pi()*(3.0f - std::sqrt(5.0f));
+
+template<class T> void append(Containers::Array<char>& out, const T& value) {
+    arrayAppend(out, Containers::arrayView(reinterpret_cast<const char*>(&value), sizeof(T)));
+}
+
+template<class T> bool take(Containers::ArrayView<const char>& in, T& value) {
+    if(in.size() < sizeof(T)) return false;
+    std::memcpy(&value, in.data(), sizeof(T));
+    in = in.exceptPrefix(sizeof(T));
+    return true;
+}
+
+}
+
+LayoutCache::LayoutCache(const std::string& directory, const std::string& input): _directory{directory} {
+    Containers::Optional<Containers::String> current = Utility::Path::currentDirectory();
+    const std::string absolute = current ? std::string{Utility::Path::join(*current, input)} : input;
+    _filename = Utility::Path::join(directory, Utility::MurmurHash2{}(absolute).hexString() + ".layout");
+}
+
+Utility::Sha1::Digest LayoutCache::contentHash(const GraphData& graph) {
+    Utility::Sha1 sha1;
+    /* Sizes first so tag boundaries can't shift without changing the
+       hash */
+    for(const std::string& tag: graph.tags) {
+        const UnsignedInt size = tag.size();
+        sha1 << Containers::arrayView(reinterpret_cast<const char*>(&size), sizeof(size)) << tag;
+    }
+    sha1 << Containers::arrayCast<const char>(Containers::arrayView(graph.edges));
+    return sha1.digest();
+}
+
+bool LayoutCache::load(const GraphData& graph, ForceLayout& layout) const {
+    if(!Utility::Path::exists(_filename)) return false;
+    const Containers::Optional<Containers::Array<char>> data = Utility::Path::read(_filename);
+    if(!data) return false;
+
+    Containers::ArrayView<const char> in = *data;
+    char magic[sizeof(Magic)];
+    char digest[Utility::Sha1::DigestSize];
+    UnsignedInt count;
+    if(!take(in, magic) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+       !take(in, digest) || !take(in, count)) {
+        Warning{} << "Ignoring an invalid layout cache" << _filename;
+        return false;
+    }
+
+    /* Every entry takes at least a size and a position, so a corrupted
+       count can't make it reserve more than the file could hold */
+    std::unordered_map<std::string, Vector2> cached;
+    cached.reserve(Math::min(std::size_t(count), in.size()/(sizeof(UnsignedInt) + sizeof(Vector2))));
+    for(UnsignedInt i = 0; i != count; ++i) {
+        UnsignedInt size;
+        Vector2 position;
+        if(!take(in, size) || in.size() < size) {
+            Warning{} << "Ignoring a truncated layout cache" << _filename;
+            return false;
+        }
+        std::string tag{in.data(), size};
+        in = in.exceptPrefix(size);
+        if(!take(in, position)) {
+            Warning{} << "Ignoring a truncated layout cache" << _filename;
+            return false;
+        }
+        cached.emplace(std::move(tag), position);
+    }
+
+    const std::size_t nodeCount = graph.nodeCount();
+    Containers::Array<Vector2> positions{NoInit, nodeCount};
+    Utility::copy(layout.positions(), positions);
+    Containers::Array<bool> placed{ValueInit, nodeCount};
+    Containers::Array<UnsignedInt> queue;
+    for(std::size_t i = 0; i != nodeCount; ++i) {
+        const auto found = cached.find(graph.tags[i]);
+        if(found == cached.end()) continue;
+        positions[i] = found->second;
+        placed[i] = true;
+        arrayAppend(queue, UnsignedInt(i));
+    }
+    const std::size_t cachedCount = queue.size();
+    if(!cachedCount) return false;
+
+    /* Breadth-first from the cached nodes, so chains of new ones grow
+       outwards from where they attach. Nodes not connected to anything
+       cached keep their initial position. */
+    Containers::Array<UnsignedInt> offsets{ValueInit, nodeCount + 1};
+    for(const Vector2ui& edge: graph.edges) {
+        ++offsets[edge.x() + 1];
+        ++offsets[edge.y() + 1];
+    }
+    for(std::size_t i = 0; i != nodeCount; ++i)
+        offsets[i + 1] += offsets[i];
+    Containers::Array<UnsignedInt> neighbours{NoInit, offsets[nodeCount]};
+    {
+        Containers::Array<UnsignedInt> fill{NoInit, nodeCount};
+        Utility::copy(offsets.prefix(nodeCount), fill);
+        for(const Vector2ui& edge: graph.edges) {
+            neighbours[fill[edge.x()]++] = edge.y();
+            neighbours[fill[edge.y()]++] = edge.x();
+        }
+    }
+    UnsignedInt newCount = 0;
+    for(std::size_t q = 0; q != queue.size(); ++q) {
+        for(UnsignedInt i = offsets[queue[q]]; i != offsets[queue[q] + 1]; ++i) {
+            const UnsignedInt node = neighbours[i];
+            if(placed[node]) continue;
+
+            Vector2 sum;
+            UnsignedInt sumCount = 0;
+            for(UnsignedInt j = offsets[node]; j != offsets[node + 1]; ++j) {
+                if(!placed[neighbours[j]]) continue;
+                sum += positions[neighbours[j]];
+                ++sumCount;
+            }
+            const Float angle = newCount++*NeighbourAngle;
+            positions[node] = sum/Float(sumCount) + NeighbourOffset*Vector2{std::cos(angle), std::sin(angle)};
+            placed[node] = true;
+            arrayAppend(queue, node);
+        }
+    }
+
+    layout.setPositions(positions);
+    if(std::memcmp(digest, contentHash(graph).byteArray(), sizeof(digest)) == 0) {
+        layout.setAlpha(ForceLayout::AlphaMin);
+        Debug{} << "Warm start from an unchanged layout in" << _filename;
+    } else {
+        layout.setAlpha(Math::clamp(PartialAlpha*Float(nodeCount - cachedCount)/Float(nodeCount), ForceLayout::AlphaMin, PartialAlpha));
+        Debug{} << "Warm start with" << cachedCount << "of" << nodeCount << "nodes from" << _filename;
+    }
+    return true;
+}
+
+bool LayoutCache::save(const GraphData& graph, const Containers::ArrayView<const Vector2> positions) const {
+    Containers::Array<char> out;
+    arrayAppend(out, Containers::arrayView(Magic));
+    arrayAppend(out, Containers::arrayView(contentHash(graph).byteArray(), Utility::Sha1::DigestSize));
+    append(out, UnsignedInt(graph.nodeCount()));
+    for(std::size_t i = 0; i != graph.nodeCount(); ++i) {
+        append(out, UnsignedInt(graph.tags[i].size()));
+        arrayAppend(out, Containers::arrayView(graph.tags[i].data(), graph.tags[i].size()));
+        append(out, positions[i]);
+    }
+
+    return Utility::Path::make(_directory) &&
+           Utility::Path::write(_filename, out);
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef LayoutCache_h
+#define LayoutCache_h
+
+#include <string>
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Utility/Sha1.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector2.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+class ForceLayout;
+struct GraphData;
+
+/* Settled node positions of a graph, kept across runs so a revisit doesn't
+   start the simulation from scratch. There's one file per input, named by
+   a MurmurHash2 of its absolute path. Positions are stored by node tag, so
+   they survive nodes being added, and next to them is a Sha1 of the graph
+   contents --- if that still matches, the layout is already settled. */
+class LayoutCache {
+    public:
+        explicit LayoutCache(const std::string& directory, const std::string& input);
+
+        const std::string& filename() const { return _filename; }
+
+        /* Sha1 of the node tags and edges, which is all the layout depends
+           on */
+        static Utility::Sha1::Digest contentHash(const GraphData& graph);
+
+        /* Moves cached nodes to their cached positions, places the rest
+           next to their neighbours and lowers the layout alpha to match.
+           Returns false if there's nothing usable in the cache, the layout
+           is untouched then. */
+        bool load(const GraphData& graph, ForceLayout& layout) const;
+
+        bool save(const GraphData& graph, Containers::ArrayView<const Vector2> positions) const;
+
+    private:
+        std::string _directory, _filename;
+};
+
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include "LayoutThread.h"
+
+#include <chrono>
+#include <Corrade/Utility/Algorithms.h>
+#include <Corrade/Utility/DebugStl.h>
+
+#include "LayoutCache.h"
+
+namespace Breadcrumbs {
+
+namespace {
+
+/* How long to sleep between polls for commands once the layout cools down */
+constexpr std::chrono::milliseconds IdleInterval{4};
+
+/* Ticks between LOD rebuilds. Clusters move slowly compared to nodes and the
+   finest level uses live positions anyway. */
+constexpr UnsignedLong LodInterval = 64;
+
+}
+
+LayoutThread::LayoutThread(ForceLayout&& layout): _layout{std::move(layout)}, _nodeCount{_layout.nodeCount()} {
+    /* Preallocate all three slots so publishing is a plain copy */
+    for(std::size_t i = 0; i != 3; ++i) {
+        LayoutFrame& frame = _frames.slots()[i];
+        frame.positions = Containers::Array<Vector2>{ValueInit, _nodeCount};
+        frame.tick = 0;
+        frame.stepDuration = 0;
+        frame.alpha = _layout.alpha();
+        frame.active = true;
+    }
+
+    /* Make the initial arrangement visible before the first tick */
+    publish();
+}
+
+LayoutThread::~LayoutThread() {
+    stop();
+}
+
+void LayoutThread::enableLod(Containers::Array<UnsignedInt>&& edgeWeights, Containers::Array<UnsignedInt>&& groups) {
+    _lodEdgeWeights = std::move(edgeWeights);
+    _lodGroups = std::move(groups);
+    _lods.back().build(_layout.positions(), _layout.links(), _lodEdgeWeights, _lodGroups);
+    _lods.publish();
+}
+
+void LayoutThread::enableCache(Containers::Pointer<LayoutCache>&& cache, const GraphData& graph) {
+    _cache = std::move(cache);
+    _cacheGraph = &graph;
+}
+
+void LayoutThread::start() {
+    if(_running.exchange(true)) return;
+    _thread = std::thread{&LayoutThread::run, this};
+}
+
+void LayoutThread::stop() {
+    if(!_running.exchange(false)) return;
+    _thread.join();
+}
+
+bool LayoutThread::pin(const UnsignedInt node, const Vector2& position) {
+    return _commands.push({LayoutCommand::Type::Pin, node, position, 0.0f});
+}
+
+bool LayoutThread::unpin(const UnsignedInt node) {
+    return _commands.push({LayoutCommand::Type::Unpin, node, {}, 0.0f});
+}
+
+bool LayoutThread::setAlphaTarget(const Float target) {
+    return _commands.push({LayoutCommand::Type::SetAlphaTarget, 0, {}, target});
+}
+
+bool LayoutThread::setAlpha(const Float alpha) {
+    return _commands.push({LayoutCommand::Type::SetAlpha, 0, {}, alpha});
+}
+
+void LayoutThread::publish() {
+    LayoutFrame& frame = _frames.back();
+    Utility::copy(_layout.positions(), Containers::arrayView(frame.positions));
+    /* Rebuilt here so the render thread never pays for it */
+    frame.grid.build(frame.positions);
+    frame.edgeGrid.build(frame.positions, _layout.links());
+    frame.tick = _tick;
+    frame.stepDuration = _stepDuration;
+    frame.alpha = _layout.alpha();
+    frame.active = _layout.isActive();
+    _frames.publish();
+
+    if(isLodEnabled() && (_tick - _lodTick >= LodInterval || !frame.active)) {
+        _lods.back().build(frame.positions, _layout.links(), _lodEdgeWeights, _lodGroups);
+        _lods.publish();
+        _lodTick = _tick;
+    }
+}
+
+void LayoutThread::save() {
+    if(!_cache || _savedTick == _tick) return;
+    _savedTick = _tick;
+    if(!_cache->save(*_cacheGraph, _layout.positions()))
+        Warning{} << "Can't save the layout to" << _cache->filename();
+}
+
+void LayoutThread::run() {
+    while(_running.load(std::memory_order_relaxed)) {
+        bool changed = false;
+        LayoutCommand command;
+        while(_commands.pop(command)) {
+            switch(command.type) {
+                case LayoutCommand::Type::Pin:
+                    _layout.pin(command.node, command.position);
+                    break;
+                case LayoutCommand::Type::Unpin:
+                    _layout.unpin(command.node);
+                    break;
+                case LayoutCommand::Type::SetAlphaTarget:
+                    _layout.setAlphaTarget(command.value);
+                    break;
+                case LayoutCommand::Type::SetAlpha:
+                    _layout.setAlpha(command.value);
+                    break;
+            }
+            changed = true;
+        }
+
+        if(_layout.isActive()) {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            _layout.step();
+            _stepDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            ++_tick;
+            publish();
+        } else {
+            /* Let the final state and any pin changes through, then idle */
+            _stepDuration = 0;
+            if(changed) publish();
+            save();
+            std::this_thread::sleep_for(IdleInterval);
+        }
+    }
+}
+
+}
@@ -0,0 +1,125 @@
+#ifndef LayoutThread_h
+#define LayoutThread_h
+
+#include <atomic>
+#include <thread>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pointer.h>
+
+#include "EdgeGrid.h"
+#include "ForceLayout.h"
+#include "LodHierarchy.h"
+#include "SpatialGrid.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+namespace Breadcrumbs {
+
+class LayoutCache;
+struct GraphData;
+
+/* Snapshot of the layout handed over to the render loop */
+struct LayoutFrame {
+    Containers::Array<Vector2> positions;
+    /* Index over positions, for picking, hover and selection */
+    SpatialGrid grid;
+    /* Index over edge segments, for culling */
+    EdgeGrid edgeGrid;
+    UnsignedLong tick;
+    /* How long the tick took, in nanoseconds, 0 if this frame isn't a
+       result of one */
+    UnsignedLong stepDuration;
+    Float alpha;
+    /* False once the simulation cooled down and stopped ticking */
+    bool active;
+};
+
+/* Interaction forwarded from the render loop, the equivalent of the
+   dragstarted / dragged / dragended handlers in graph.js */
+struct LayoutCommand {
+    enum class Type: UnsignedByte {
+        Pin,
+        Unpin,
+        SetAlphaTarget,
+        SetAlpha
+    };
+
+    Type type;
+    UnsignedInt node;
+    Vector2 position;
+    Float value;
+};
+
+/* Runs a ForceLayout on its own thread. Positions are published through a
+   triple buffer and commands arrive through a lock-free queue, so a slow
+   tick never stalls a frame and a slow frame never stalls the simulation. */
+class LayoutThread {
+    public:
+        explicit LayoutThread(ForceLayout&& layout);
+
+        /* Stops and joins the thread */
+        ~LayoutThread();
+
+        LayoutThread(const LayoutThread&) = delete;
+        LayoutThread& operator=(const LayoutThread&) = delete;
+
+        std::size_t nodeCount() const { return _nodeCount; }
+
+        /* Makes the thread also maintain a LodHierarchy, rebuilt every few
+           dozen ticks and once the layout settles. Has to be called before
+           start(). */
+        void enableLod(Containers::Array<UnsignedInt>&& edgeWeights, Containers::Array<UnsignedInt>&& groups);
+        bool isLodEnabled() const { return !_lodGroups.isEmpty(); }
+
+        /* Makes the thread save the positions to the cache whenever the
+           layout settles, so the render loop never waits for the file. The
+           graph has to outlive the thread. Has to be called before
+           start(). */
+        void enableCache(Containers::Pointer<LayoutCache>&& cache, const GraphData& graph);
+
+        void start();
+        void stop();
+
+        /* Render loop side. The command functions return false if the queue
+           is full, which only happens when the simulation thread is stuck
+           for hundreds of frames. */
+        bool pin(UnsignedInt node, const Vector2& position);
+        bool unpin(UnsignedInt node);
+        bool setAlphaTarget(Float target);
+        bool setAlpha(Float alpha);
+
+        /* Picks up the newest published frame, returns true if there was
+           one. Then frame() stays the same until the next update. */
+        bool updateFrame() { return _frames.update(); }
+        const LayoutFrame& frame() const { return _frames.front(); }
+
+        /* Same as above for the LOD hierarchy, which is published less
+           often than frames */
+        bool updateLod() { return _lods.update(); }
+        bool hasNewLod() const { return _lods.isFresh(); }
+        const LodHierarchy& lod() const { return _lods.front(); }
+
+    private:
+        void run();
+        void publish();
+        void save();
+
+        ForceLayout _layout;
+        const std::size_t _nodeCount;
+        UnsignedLong _tick{}, _stepDuration{};
+        TripleBuffer<LayoutFrame> _frames;
+        Containers::Array<UnsignedInt> _lodEdgeWeights, _lodGroups;
+        UnsignedLong _lodTick{};
+        TripleBuffer<LodHierarchy> _lods;
+        Containers::Pointer<LayoutCache> _cache;
+        const GraphData* _cacheGraph{};
+        /* Settled positions are saved once per settled tick */
+        UnsignedLong _savedTick{~0ull};
+        SpscQueue<LayoutCommand, 1024> _commands;
+        std::atomic<bool> _running{false};
+        std::thread _thread;
+};
+
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include "LodHierarchy.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Magnum/Math/Functions.h>
+
+namespace Breadcrumbs {
+
+namespace {
+
+/* Screen area a single node or cluster is allowed to take on average before
+   the tile switches to a coarser level */
+constexpr Float PixelsPerPrimitive = 8.0f*8.0f;
+
+}
+
+void LodHierarchy::build(const Containers::ArrayView<const Vector2> positions, const Containers::ArrayView<const Vector2ui> edges, const Containers::ArrayView<const UnsignedInt> edgeWeights, const Containers::ArrayView<const UnsignedInt> groups) {
+    for(Level& level: _levels) level = Level{};
+
+    const std::size_t count = positions.size();
+    if(!count) {
+        _bounds = {};
+        _tileCount = {};
+        return;
+    }
+
+    Vector2 min = positions[0], max = positions[0];
+    for(const Vector2& position: positions) {
+        min = Math::min(min, position);
+        max = Math::max(max, position);
+    }
+    _bounds = {min, max};
+    _tileSize = Math::max((max - min).max(), 1.0f)/TilesPerSide;
+    _tileCount = Math::clamp(Vector2i{Math::floor((max - min)/_tileSize)} + Vector2i{1}, Vector2i{1}, Vector2i{TilesPerSide});
+    const std::size_t tileCount = std::size_t(_tileCount.product());
+
+    const auto tileOf = [&](const Vector2& position) {
+        const Vector2i tile = Math::clamp(Vector2i{Math::floor((position - min)/_tileSize)}, Vector2i{0}, _tileCount - Vector2i{1});
+        return UnsignedLong(tile.y())*_tileCount.x() + tile.x();
+    };
+
+    Containers::Array<UnsignedInt> clusterOf{NoInit, count};
+    std::vector<std::pair<UnsignedLong, UnsignedInt>> keys(count);
+    std::vector<std::pair<UnsignedLong, UnsignedInt>> edgeKeys;
+    edgeKeys.reserve(edges.size());
+
+    for(UnsignedInt k = 0; k != LevelCount; ++k) {
+        Level& level = _levels[k];
+        level.nodeClusters = Containers::Array<UnsignedInt>{NoInit, count};
+
+        /* Key is the tile in the upper half and the node or cell inside the
+           tile in the lower half, so sorting groups by tile first */
+        const Int cellsPerSide = k ? 1 << (LevelCount - 1 - k) : 0;
+        level.cellSize = k ? _tileSize/cellsPerSide : 0.0f;
+        for(std::size_t i = 0; i != count; ++i) {
+            const UnsignedLong tile = tileOf(positions[i]);
+            UnsignedLong local = i;
+            if(k) {
+                const Vector2 tileMin = min + Vector2{Vector2i{Int(tile % _tileCount.x()), Int(tile/_tileCount.x())}}*_tileSize;
+                const Vector2i cell = Math::clamp(Vector2i{Math::floor((positions[i] - tileMin)/level.cellSize)}, Vector2i{0}, Vector2i{cellsPerSide - 1});
+                local = UnsignedLong(cell.y())*cellsPerSide + cell.x();
+            }
+            keys[i] = {tile << 32 | local, UnsignedInt(i)};
+        }
+        std::sort(keys.begin(), keys.end());
+
+        /* Consecutive runs of the same key are one cluster */
+        for(std::size_t i = 0; i != count; ++i) {
+            const UnsignedInt node = keys[i].second;
+            if(!i || keys[i].first != keys[i - 1].first) {
+                if(!k) arrayAppend(level.ids, node);
+                arrayAppend(level.positions, Vector2{});
+                arrayAppend(level.counts, 0u);
+                arrayAppend(level.groups, groups[node]);
+                arrayAppend(level.tiles, UnsignedInt(keys[i].first >> 32));
+            }
+            const UnsignedInt cluster = level.positions.size() - 1;
+            clusterOf[node] = cluster;
+            level.nodeClusters[node] = cluster;
+            level.positions[cluster] += positions[node];
+            ++level.counts[cluster];
+        }
+        for(std::size_t i = 0; i != level.positions.size(); ++i)
+            level.positions[i] /= Float(level.counts[i]);
+
+        level.tileOffsets = Containers::Array<UnsignedInt>{ValueInit, tileCount + 1};
+        for(const UnsignedInt tile: level.tiles) ++level.tileOffsets[tile + 1];
+        for(std::size_t i = 0; i != tileCount; ++i)
+            level.tileOffsets[i + 1] += level.tileOffsets[i];
+
+        /* Bundle parallel edges between the same pair of clusters and drop
+           the ones inside a cluster */
+        edgeKeys.clear();
+        for(std::size_t i = 0; i != edges.size(); ++i) {
+            UnsignedLong a = clusterOf[edges[i].x()];
+            UnsignedLong b = clusterOf[edges[i].y()];
+            if(a == b) continue;
+            if(a > b) std::swap(a, b);
+            edgeKeys.emplace_back(a << 32 | b, edgeWeights[i]);
+        }
+        std::sort(edgeKeys.begin(), edgeKeys.end());
+        std::size_t unique = 0;
+        for(std::size_t i = 0; i != edgeKeys.size(); ++i) {
+            if(unique && edgeKeys[unique - 1].first == edgeKeys[i].first)
+                edgeKeys[unique - 1].second += edgeKeys[i].second;
+            else edgeKeys[unique++] = edgeKeys[i];
+        }
+        edgeKeys.resize(unique);
+
+        /* Store both directions, bucketed by the tile of the first end */
+        level.edgeTileOffsets = Containers::Array<UnsignedInt>{ValueInit, tileCount + 2};
+        for(const std::pair<UnsignedLong, UnsignedInt>& edge: edgeKeys) {
+            ++level.edgeTileOffsets[level.tiles[edge.first >> 32] + 2];
+            ++level.edgeTileOffsets[level.tiles[edge.first & 0xffffffffu] + 2];
+        }
+        for(std::size_t i = 2; i != tileCount + 2; ++i)
+            level.edgeTileOffsets[i] += level.edgeTileOffsets[i - 1];
+        level.edges = Containers::Array<Vector2ui>{NoInit, unique*2};
+        level.edgeWeights = Containers::Array<UnsignedInt>{NoInit, unique*2};
+        for(const std::pair<UnsignedLong, UnsignedInt>& edge: edgeKeys) {
+            const UnsignedInt a = edge.first >> 32;
+            const UnsignedInt b = edge.first & 0xffffffffu;
+            const UnsignedInt ab = level.edgeTileOffsets[level.tiles[a] + 1]++;
+            level.edges[ab] = {a, b};
+            level.edgeWeights[ab] = edge.second;
+            const UnsignedInt ba = level.edgeTileOffsets[level.tiles[b] + 1]++;
+            level.edges[ba] = {b, a};
+            level.edgeWeights[ba] = edge.second;
+        }
+        /* The scatter shifted the offsets by one, drop the extra item */
+        arrayRemoveSuffix(level.edgeTileOffsets, 1);
+    }
+}
+
+void LodHierarchy::updateTileLevels(const Float pixelsPerUnit) const {
+    /* Finest level that fits the budget of each tile */
+    const std::size_t tileCount = std::size_t(_tileCount.product());
+    const Float tilePixels = Math::pow<2>(_tileSize*pixelsPerUnit);
+    const Float budget = tilePixels/PixelsPerPrimitive;
+    arrayResize(_tileLevels, NoInit, tileCount);
+    for(std::size_t t = 0; t != tileCount; ++t) {
+        UnsignedInt k = 0;
+        while(k != LevelCount - 1 && _levels[k].tileOffsets[t + 1] - _levels[k].tileOffsets[t] > budget)
+            ++k;
+        _tileLevels[t] = k;
+    }
+}
+
+void LodHierarchy::collect(const Range2D& visible, const Float pixelsPerUnit, const Containers::ArrayView<const Vector2> currentPositions, DrawList& out) const {
+    arrayResize(out.nodePositions, NoInit, 0);
+    arrayResize(out.nodeIds, NoInit, 0);
+    arrayResize(out.nodeCounts, NoInit, 0);
+    arrayResize(out.nodeGroups, NoInit, 0);
+    arrayResize(out.edgeLines, NoInit, 0);
+    arrayResize(out.edgeWeights, NoInit, 0);
+    if(isEmpty()) return;
+
+    /* Done for all tiles as edges need to know the level at their other
+       end */
+    updateTileLevels(pixelsPerUnit);
+
+    const Vector2i tileMin = Math::clamp(Vector2i{Math::floor((visible.min() - _bounds.min())/_tileSize)}, Vector2i{0}, _tileCount - Vector2i{1});
+    const Vector2i tileMax = Math::clamp(Vector2i{Math::floor((visible.max() - _bounds.min())/_tileSize)}, Vector2i{0}, _tileCount - Vector2i{1});
+    const auto isVisible = [&](const UnsignedInt tile) {
+        const Vector2i coords{Int(tile % _tileCount.x()), Int(tile/_tileCount.x())};
+        return (coords >= tileMin).all() && (coords <= tileMax).all();
+    };
+
+    for(Int y = tileMin.y(); y <= tileMax.y(); ++y) {
+        for(Int x = tileMin.x(); x <= tileMax.x(); ++x) {
+            const UnsignedInt tile = y*_tileCount.x() + x;
+            const UnsignedInt k = _tileLevels[tile];
+            const Level& level = _levels[k];
+            const auto positionOf = [&](const UnsignedInt cluster) {
+                return k ? level.positions[cluster] : currentPositions[level.ids[cluster]];
+            };
+
+            for(UnsignedInt i = level.tileOffsets[tile]; i != level.tileOffsets[tile + 1]; ++i) {
+                arrayAppend(out.nodePositions, positionOf(i));
+                arrayAppend(out.nodeIds, k ? ~0u : level.ids[i]);
+                arrayAppend(out.nodeCounts, level.counts[i]);
+                arrayAppend(out.nodeGroups, level.groups[i]);
+            }
+
+            /* Each edge is drawn once, by the visible end with the coarser
+               level. An edge going off-screen is drawn by the visible end. */
+            for(UnsignedInt i = level.edgeTileOffsets[tile]; i != level.edgeTileOffsets[tile + 1]; ++i) {
+                const Vector2ui edge = level.edges[i];
+                const UnsignedInt otherTile = level.tiles[edge.y()];
+                if(isVisible(otherTile)) {
+                    const UnsignedInt otherLevel = _tileLevels[otherTile];
+                    if(otherLevel > k) continue;
+                    if(otherLevel == k && (otherTile < tile || (otherTile == tile && edge.y() < edge.x())))
+                        continue;
+                }
+                arrayAppend(out.edgeLines, positionOf(edge.x()));
+                arrayAppend(out.edgeLines, positionOf(edge.y()));
+                arrayAppend(out.edgeWeights, level.edgeWeights[i]);
+            }
+        }
+    }
+}
+
+void LodHierarchy::nodePositions(const Float pixelsPerUnit, const Containers::ArrayView<const Vector2> currentPositions, const Containers::ArrayView<Vector2> out) const {
+    /* Not built yet or for a different graph, nothing is clustered */
+    if(_levels[0].nodeClusters.size() != out.size()) {
+        Utility::copy(currentPositions, out);
+        return;
+    }
+
+    updateTileLevels(pixelsPerUnit);
+    for(std::size_t i = 0; i != out.size(); ++i) {
+        const UnsignedInt k = _tileLevels[_levels[0].tiles[_levels[0].nodeClusters[i]]];
+        out[i] = k ? _levels[k].positions[_levels[k].nodeClusters[i]] : currentPositions[i];
+    }
+}
+
+}
@@ -0,0 +1,101 @@
+#ifndef LodHierarchy_h
+#define LodHierarchy_h
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Range.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Level-of-detail hierarchy for zoomed-out views. The layout is split into
+   square tiles, and every tile holds the same nodes at several levels:
+   level 0 is the nodes themselves, each next level merges them into
+   clusters on a grid twice as coarse, up to a single cluster per tile.
+   Edges at each level are bundled into weighted super-edges between
+   clusters.
+
+   collect() then picks a level per visible tile so that the number of
+   primitives stays proportional to the tile's area on screen, meaning the
+   frame cost depends on what's visible and not on the size of the graph. */
+class LodHierarchy {
+    public:
+        enum: UnsignedInt {
+            LevelCount = 6,
+            /* Tiles along the longer side of the layout */
+            TilesPerSide = 16
+        };
+
+        struct Level {
+            Float cellSize;
+            /* Clusters sorted by tile. For level 0 these are nodes and ids
+               are the node IDs, for other levels ids is empty. */
+            Containers::Array<UnsignedInt> ids;
+            Containers::Array<Vector2> positions;
+            Containers::Array<UnsignedInt> counts;
+            /* Group of the first member, for coloring */
+            Containers::Array<UnsignedInt> groups;
+            Containers::Array<UnsignedInt> tiles;
+            /* Cluster range for each tile, tileCount + 1 items */
+            Containers::Array<UnsignedInt> tileOffsets;
+            /* Cluster containing each node */
+            Containers::Array<UnsignedInt> nodeClusters;
+
+            /* Super-edges, each stored in both directions and sorted by the
+               tile of the first cluster, with a range for each tile */
+            Containers::Array<Vector2ui> edges;
+            Containers::Array<UnsignedInt> edgeWeights;
+            Containers::Array<UnsignedInt> edgeTileOffsets;
+        };
+
+        /* What collect() decided to draw */
+        struct DrawList {
+            Containers::Array<Vector2> nodePositions;
+            /* Node ID for plain nodes, ~0u for clusters */
+            Containers::Array<UnsignedInt> nodeIds;
+            /* Member count, 1 for plain nodes */
+            Containers::Array<UnsignedInt> nodeCounts;
+            Containers::Array<UnsignedInt> nodeGroups;
+            /* Pairs of line endpoints */
+            Containers::Array<Vector2> edgeLines;
+            Containers::Array<UnsignedInt> edgeWeights;
+        };
+
+        explicit LodHierarchy() = default;
+
+        /* Builds from a snapshot of the layout. Edges are expected to be
+           unique and weights and groups have the same size as edges and
+           positions, respectively. */
+        void build(Containers::ArrayView<const Vector2> positions, Containers::ArrayView<const Vector2ui> edges, Containers::ArrayView<const UnsignedInt> edgeWeights, Containers::ArrayView<const UnsignedInt> groups);
+
+        bool isEmpty() const { return _levels[0].ids.isEmpty(); }
+        const Range2D& bounds() const { return _bounds; }
+        Float tileSize() const { return _tileSize; }
+        Vector2i tileCount() const { return _tileCount; }
+        const Level& level(UnsignedInt i) const { return _levels[i]; }
+
+        /* Fills out with what's in the visible range, at a level chosen
+           per tile. Level 0 takes node positions from currentPositions, so
+           nodes being dragged around don't lag behind. */
+        void collect(const Range2D& visible, Float pixelsPerUnit, Containers::ArrayView<const Vector2> currentPositions, DrawList& out) const;
+
+        /* Where collect() would draw each node, which is the position of
+           the cluster it's in or its current position at level 0. Used to
+           animate between the two views. */
+        void nodePositions(Float pixelsPerUnit, Containers::ArrayView<const Vector2> currentPositions, Containers::ArrayView<Vector2> out) const;
+
+    private:
+        void updateTileLevels(Float pixelsPerUnit) const;
+
+        Range2D _bounds;
+        Float _tileSize{};
+        Vector2i _tileCount;
+        Level _levels[LevelCount];
+        /* Scratch space for collect() */
+        mutable Containers::Array<UnsignedByte> _tileLevels;
+};
+
+}
+
+#endif
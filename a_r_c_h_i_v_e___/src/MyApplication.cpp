@@ -1,7 +1,63 @@
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Corrade/Containers/StringStl.h>
+#include <Corrade/PluginManager/Manager.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/DebugStl.h>
+#include <Corrade/Utility/Path.h>
+#include <Magnum/GL/Buffer.h>
 #include <Magnum/GL/DefaultFramebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/MeshTools/Compile.h>
 #include <Magnum/Platform/Sdl2Application.h>
+#include <Magnum/Primitives/Circle.h>
+#include <Magnum/Primitives/Square.h>
+#include <Magnum/Shaders/FlatGL.h>
+#include <Magnum/Shaders/Generic.h>
+#include <Magnum/Timeline.h>
+#include <Magnum/Text/AbstractFont.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "DensityRenderer.h"
+#include "EdgeBundles.h"
+#include "EdgeShader.h"
+#include "GraphData.h"
+#include "GraphStyle.h"
+#include "LabelRenderer.h"
+#include "LayoutCache.h"
+#include "LayoutThread.h"
+#include "ObjectIdPicker.h"
+#include "PositionTransition.h"
+#include "ViewerProfiler.h"
+#include "VisitSketches.h"
+#ifdef BREADCRUMBS_WITH_VULKAN
+#include "VulkanForces.h"
+#endif
+#include "readfile.h"
 
 using namespace Magnum;
+using namespace Math::Literals;
+using namespace Breadcrumbs;
+
+namespace {
+
+/* Graphs larger than this start with the LOD path, L toggles it */
+constexpr std::size_t LodNodeCount = 10000;
+/* Graphs larger than this start with the density view, H toggles it */
+constexpr std::size_t DensityNodeCount = 1000000;
+/* Clusters grow with the square root of their member count up to this */
+constexpr Float MaxClusterScale = 8.0f;
+
+}
 
 class MyApplication: public Platform::Application {
     public:
@@ -9,18 +65,655 @@ class MyApplication: public Platform::Application {
 
     private:
         void drawEvent() override;
+        void viewportEvent(ViewportEvent& event) override;
+        void mousePressEvent(MouseEvent& event) override;
+        void mouseReleaseEvent(MouseEvent& event) override;
+        void mouseMoveEvent(MouseMoveEvent& event) override;
+        void mouseScrollEvent(MouseScrollEvent& event) override;
+        void keyPressEvent(KeyEvent& event) override;
+
+        Vector2 windowToWorld(const Vector2i& position) const;
+        Range2D visibleRange() const;
+        void collectCulled(const Range2D& visible);
+        void collectLod(const Range2D& visible);
+        void collectAll(Containers::ArrayView<const Vector2> positions);
+        void toggleLod();
+        void updateLod();
+        void updateBundles();
+        bool isBundled() const;
+        void updateVisible();
+        void drawGraph(const Matrix3& transformationProjection);
+        void select(const Range2D& range);
+
+        GraphData _graph;
+        Containers::Pointer<LayoutThread> _layout;
+
+        Shaders::FlatGL2D _nodeShader{NoCreate};
+        /* Only what's on screen gets uploaded, either culled nodes and
+           edges or LOD clusters and bundled edges. Straight edges are
+           instanced quads, all of them one draw call. */
+        EdgeShader _edgeShader{NoCreate};
+        GL::Buffer _nodeInstanceBuffer, _edgeBuffer;
+        GL::Buffer _transformationProjectionUniform, _edgeDrawUniform;
+        GL::Mesh _nodeMesh{NoCreate}, _edgeMesh{NoCreate};
+        Containers::Array<NodeInstance> _nodeInstances;
+        Containers::Array<EdgeInstance> _edgeInstances;
+        Containers::Array<Color3> _nodeColors;
+        Containers::Array<UnsignedInt> _visibleNodes, _visibleEdges;
+
+        /* Clusters and bundled edges for zoomed-out views */
+        bool _lod{};
+        LodHierarchy::DrawList _lodDrawList;
+
+        /* Heatmap of all nodes instead of nodes, edges and labels. Created
+           on first use. */
+        bool _densityView{};
+        Containers::Pointer<DensityRenderer> _density;
+
+        /* Switching between nodes and clusters moves every node between its
+           own position and the position of its cluster instead of jumping.
+           Towards clusters the targets are fixed, the other way it's the
+           live layout. */
+        Timeline _timeline;
+        PositionTransition _transition;
+        Containers::Array<Vector2> _transitionTargets;
+        bool _transitionToLod{};
+
+        /* Bundled edges, built in the background whenever the layout
+           settles and drawn instead of the straight ones, B toggles. One
+           line strip per edge, only the visible ones drawn with a single
+           multi-draw call. */
+        bool _bundling{};
+        std::future<EdgeBundles> _pendingBundles;
+        UnsignedLong _pendingBundlesTick{}, _bundlesTick{~0ull};
+        Shaders::FlatGL2D _bundleShader{NoCreate};
+        GL::Buffer _bundleBuffer;
+        GL::Mesh _bundleMesh{GL::MeshPrimitive::LineStrip};
+        UnsignedInt _bundlePointsPerEdge{};
+        Containers::Array<UnsignedInt> _bundleCounts, _bundleOffsets;
+
+        /* Node tags, if a font was given */
+        PluginManager::Manager<Text::AbstractFont> _fontManager;
+        Containers::Pointer<Text::AbstractFont> _font;
+        Containers::Pointer<LabelRenderer> _labels;
+        /* Total visit count of each node, more visited get labels first */
+        Containers::Array<UnsignedInt> _labelPriorities;
+        Containers::Array<UnsignedInt> _labelCandidates;
+
+        /* Hover ring and the selection rectangle */
+        Shaders::FlatGL2D _highlightShader{NoCreate};
+        GL::Mesh _hoverMesh{NoCreate}, _selectionMesh{NoCreate};
+
+        /* The d3 zoom transform, in window-centered coordinates with Y up */
+        Vector2 _translation;
+        Float _zoom{1.0f};
+
+        Int _dragged{-1};
+        Vector2 _dragOffset;
+
+        Int _hovered{-1};
+        bool _selecting{};
+        Vector2 _selectionStart;
+        Range2D _selectionRange;
+        Containers::Array<UnsignedInt> _selection;
+        Containers::Array<bool> _selected;
+
+        /* Hover and drag subject come from the GPU instead of the grid */
+        bool _gpuPicking{};
+        bool _pickRequested{};
+        Vector2i _pickPosition;
+        Containers::Pointer<ObjectIdPicker> _picker;
+
+        /* Frame timings and viewer counters, F toggles */
+        Containers::Pointer<ViewerProfiler> _profiler;
 };
 
-MyApplication::MyApplication(const Arguments& arguments): Platform::Application{arguments} {
-    /* TODO: Add your initialization code here */
+MyApplication::MyApplication(const Arguments& arguments): Platform::Application{arguments, NoCreate} {
+    Utility::Arguments args;
+    args.addArgument("input").setHelp("input", "visit history, one tag and link per line")
+        .addOption("font").setHelp("font", "TrueType font for node labels, no labels if not set", "FILE")
+        .addOption("layout-backend", "cpu").setHelp("layout-backend", "where to compute layout forces, cpu or vulkan", "NAME")
+        .addOption("layout-cache").setHelp("layout-cache", "directory to keep settled layouts in, none to disable", "DIR")
+        .addOption("profile-output").setHelp("profile-output", "stream per-frame profiling data to a .csv or .json file, enables the profiler", "FILE")
+        .addSkippedPrefix("magnum", "engine-specific options")
+        .setGlobalHelp("Interactive viewer for the browsing history graph.")
+        .parse(arguments.argc, arguments.argv);
+
+    create(Configuration{}
+        .setTitle("Breadcrumbs")
+        .setWindowFlags(Configuration::WindowFlag::Resizable));
+
+    /* Summaries of the visit stream are gathered while reading it, the
+       window being the hour up to the last visit with a time */
+    VisitSketches visits;
+    Windowed<VisitSketches> lastHour{VisitSketches{}, 6, 10*60};
+    Wgraph wgraph;
+    ReadFile(args.value("input"), wgraph, nullptr, nullptr,
+        [&](const std::string& tag, const std::string& link, long long time) {
+            visits.add(tag, link);
+            if(time == Sessions::NoTime) return;
+            if(VisitSketches* slot = lastHour.at(time)) slot->add(tag, link);
+        });
+    _graph = graphDataFromWgraph(wgraph);
+    {
+        Debug d;
+        d << "About" << UnsignedLong(visits.pages.estimate() + 0.5) << "distinct pages, top domains in the last hour:";
+        for(const std::pair<std::string, UnsignedInt>& domain: lastHour.merged().domains.top())
+            d << domain.first << Debug::nospace << "(" << Debug::nospace << domain.second << Debug::nospace << ")";
+    }
+
+    std::string layoutCache = args.value("layout-cache");
+    if(layoutCache.empty()) {
+        if(Containers::Optional<Containers::String> configuration = Utility::Path::configurationDirectory("breadcrumbs"))
+            layoutCache = Utility::Path::join(*configuration, "layouts");
+    }
+    Containers::Pointer<LayoutCache> cache;
+    if(!layoutCache.empty() && layoutCache != "none")
+        cache.emplace(layoutCache, args.value("input"));
+
+    GL::Renderer::setClearColor(BackgroundColor);
+    GL::Renderer::enable(GL::Renderer::Feature::Blending);
+    GL::Renderer::setBlendFunction(GL::Renderer::BlendFunction::SourceAlpha,
+        GL::Renderer::BlendFunction::OneMinusSourceAlpha);
+
+    /* Nodes are instanced circles, colored by the link domain */
+    _nodeColors = Containers::Array<Color3>{NoInit, _graph.nodeCount()};
+    _selected = Containers::Array<bool>{ValueInit, _graph.nodeCount()};
+    for(std::size_t i = 0; i != _graph.nodeCount(); ++i)
+        _nodeColors[i] = groupColor(_graph.groups[i]);
+    _nodeMesh = MeshTools::compile(Primitives::circle2DSolid(16));
+    _nodeMesh.addVertexBufferInstanced(_nodeInstanceBuffer, 1, 0,
+        Shaders::FlatGL2D::TransformationMatrix{},
+        Shaders::FlatGL2D::Color3{},
+        Shaders::FlatGL2D::ObjectId{});
+    _nodeShader = Shaders::FlatGL2D{
+        Shaders::FlatGL2D::Flag::InstancedTransformation|
+        Shaders::FlatGL2D::Flag::VertexColor};
+
+    /* Edges are quads expanded from instances of the visible segments,
+       bundles are line strips */
+    _edgeMesh = EdgeShader::mesh(_edgeBuffer);
+    _edgeShader = EdgeShader{};
+    _edgeDrawUniform.setData({EdgeDrawUniform{Vector2{framebufferSize()}}});
+    _bundleShader = Shaders::FlatGL2D{};
+    _bundleShader.setColor(EdgeColor);
+    _bundleMesh.addVertexBuffer(_bundleBuffer, 0, Shaders::FlatGL2D::Position{});
+
+    if(!args.value("font").empty()) {
+        _font = _fontManager.loadAndInstantiate("TrueTypeFont");
+        /* Rendered large for the distance field conversion */
+        if(!_font || !_font->openFile(args.value("font"), 110.0f)) {
+            Warning{} << "Can't open" << args.value("font") << Debug::nospace << ", labels disabled";
+            _font = nullptr;
+        } else {
+            _labels.emplace(*_font, _graph.nodeCount());
+            _labelPriorities = Containers::Array<UnsignedInt>{ValueInit, _graph.nodeCount()};
+            for(std::size_t i = 0; i != _graph.edges.size(); ++i) {
+                _labelPriorities[_graph.edges[i].x()] += _graph.edgeWeights[i];
+                _labelPriorities[_graph.edges[i].y()] += _graph.edgeWeights[i];
+            }
+        }
+    }
+
+    /* Statistics go to the screen if there's a font, to the console
+       otherwise */
+    _profiler.emplace();
+    if(_labels) _profiler->setOverlayFont(*_font, _labels->glyphCache());
+    if(!args.value("profile-output").empty() && _profiler->setOutput(args.value("profile-output")))
+        _profiler->enable();
+
+    _hoverMesh = MeshTools::compile(Primitives::circle2DWireframe(16));
+    _selectionMesh = MeshTools::compile(Primitives::squareWireframe());
+    _highlightShader = Shaders::FlatGL2D{};
+    _highlightShader.setColor(0xffffff_rgbf);
+
+    {
+        ForceLayout layout{_graph.nodeCount(), _graph.edges};
+        if(cache) cache->load(_graph, layout);
+        if(args.value("layout-backend") == "vulkan") {
+#ifdef BREADCRUMBS_WITH_VULKAN
+            if(Containers::Pointer<VulkanForces> forces = VulkanForces::tryCreate(layout, arguments.argc, arguments.argv))
+                layout.setBackend(std::move(forces));
+            else Warning{} << "Falling back to the CPU layout";
+#else
+            Warning{} << "Built without Vulkan, falling back to the CPU layout";
+#endif
+        } else if(args.value("layout-backend") != "cpu")
+            Warning{} << "Unknown layout backend" << args.value("layout-backend") << Debug::nospace << ", using cpu";
+        _layout.emplace(std::move(layout));
+    }
+    /* Saved by the layout thread whenever it settles */
+    if(cache) _layout->enableCache(std::move(cache), _graph);
+    {
+        Containers::Array<UnsignedInt> edgeWeights{NoInit, _graph.edgeWeights.size()};
+        Containers::Array<UnsignedInt> groups{NoInit, _graph.groups.size()};
+        Utility::copy(_graph.edgeWeights, edgeWeights);
+        Utility::copy(_graph.groups, groups);
+        _layout->enableLod(std::move(edgeWeights), std::move(groups));
+    }
+    _lod = _graph.nodeCount() > LodNodeCount;
+    if(_graph.nodeCount() > DensityNodeCount) {
+        _densityView = true;
+        _density.emplace(_graph, framebufferSize());
+    }
+    _layout->start();
+    _timeline.start();
+}
+
+Range2D MyApplication::visibleRange() const {
+    return {windowToWorld({0, windowSize().y()}),
+            windowToWorld({windowSize().x(), 0})};
+}
+
+void MyApplication::collectCulled(const Range2D& visible) {
+    const LayoutFrame& frame = _layout->frame();
+
+    /* Nodes are found by their center, so grow the range by the radius to
+       not lose ones that are partially on screen */
+    arrayResize(_visibleNodes, NoInit, 0);
+    frame.grid.within(visible.padded(Vector2{NodeRadius}), _visibleNodes);
+    arrayResize(_nodeInstances, NoInit, _visibleNodes.size());
+    const Matrix3 scaling = Matrix3::scaling(Vector2{NodeRadius});
+    for(std::size_t i = 0; i != _visibleNodes.size(); ++i) {
+        const UnsignedInt id = _visibleNodes[i];
+        _nodeInstances[i].transformation = Matrix3::translation(frame.positions[id])*scaling;
+        _nodeInstances[i].color = _selected[id] ? 0xffffff_rgbf : _nodeColors[id];
+        _nodeInstances[i].objectId = id + 1;
+    }
+
+    arrayResize(_visibleEdges, NoInit, 0);
+    frame.edgeGrid.within(visible, _visibleEdges);
+    const Color4ub colors[]{Math::pack<Color4ub>(EdgeColor), Math::pack<Color4ub>(SelectedEdgeColor)};
+    arrayResize(_edgeInstances, NoInit, _visibleEdges.size());
+    for(std::size_t i = 0; i != _visibleEdges.size(); ++i) {
+        const UnsignedInt id = _visibleEdges[i];
+        const Vector2ui edge = _graph.edges[id];
+        _edgeInstances[i] = {frame.positions[edge.x()], frame.positions[edge.y()],
+            edgeWidth(_graph.edgeWeights[id]),
+            colors[_selected[edge.x()] || _selected[edge.y()]]};
+    }
+}
+
+void MyApplication::collectLod(const Range2D& visible) {
+    _layout->lod().collect(visible, _zoom, _layout->frame().positions, _lodDrawList);
+
+    const std::size_t count = _lodDrawList.nodePositions.size();
+    arrayResize(_nodeInstances, NoInit, count);
+    for(std::size_t i = 0; i != count; ++i) {
+        const UnsignedInt id = _lodDrawList.nodeIds[i];
+        const Float radius = NodeRadius*Math::min(std::sqrt(Float(_lodDrawList.nodeCounts[i])), MaxClusterScale);
+        _nodeInstances[i].transformation = Matrix3::translation(_lodDrawList.nodePositions[i])*Matrix3::scaling(Vector2{radius});
+        _nodeInstances[i].color = id != ~0u && _selected[id] ? 0xffffff_rgbf :
+            groupColor(_lodDrawList.nodeGroups[i]);
+        /* ~0u wraps to 0, which is the background, so clusters can't be
+           picked */
+        _nodeInstances[i].objectId = id + 1;
+    }
+
+    /* Cluster edges carry the summed visits of all edges inside */
+    const Color4ub color = Math::pack<Color4ub>(EdgeColor);
+    const std::size_t edgeCount = _lodDrawList.edgeWeights.size();
+    arrayResize(_edgeInstances, NoInit, edgeCount);
+    for(std::size_t i = 0; i != edgeCount; ++i)
+        _edgeInstances[i] = {_lodDrawList.edgeLines[i*2 + 0], _lodDrawList.edgeLines[i*2 + 1],
+            edgeWidth(_lodDrawList.edgeWeights[i]), color};
+}
+
+void MyApplication::collectAll(const Containers::ArrayView<const Vector2> positions) {
+    /* Nodes come from and go everywhere, so nothing is culled */
+    arrayResize(_visibleNodes, NoInit, positions.size());
+    arrayResize(_nodeInstances, NoInit, positions.size());
+    const Matrix3 scaling = Matrix3::scaling(Vector2{NodeRadius});
+    for(std::size_t i = 0; i != positions.size(); ++i) {
+        _visibleNodes[i] = i;
+        _nodeInstances[i].transformation = Matrix3::translation(positions[i])*scaling;
+        _nodeInstances[i].color = _selected[i] ? 0xffffff_rgbf : _nodeColors[i];
+        _nodeInstances[i].objectId = i + 1;
+    }
+
+    const Color4ub colors[]{Math::pack<Color4ub>(EdgeColor), Math::pack<Color4ub>(SelectedEdgeColor)};
+    arrayResize(_visibleEdges, NoInit, _graph.edges.size());
+    arrayResize(_edgeInstances, NoInit, _graph.edges.size());
+    for(std::size_t i = 0; i != _graph.edges.size(); ++i) {
+        const Vector2ui edge = _graph.edges[i];
+        _visibleEdges[i] = i;
+        _edgeInstances[i] = {positions[edge.x()], positions[edge.y()],
+            edgeWidth(_graph.edgeWeights[i]),
+            colors[_selected[edge.x()] || _selected[edge.y()]]};
+    }
+}
+
+void MyApplication::toggleLod() {
+    const LayoutFrame& frame = _layout->frame();
+    const bool toLod = !_lod && !(_transition.isRunning() && _transitionToLod);
+
+    arrayResize(_transitionTargets, NoInit, frame.positions.size());
+    _layout->lod().nodePositions(_zoom, frame.positions, _transitionTargets);
+
+    /* Nodes are shown during the whole transition and replaced with
+       clusters only at the end. Pressing L again in the middle turns
+       around from where the nodes are. */
+    if(_transition.isRunning()) _transition.start(_transition.positions());
+    else _transition.start(toLod ? frame.positions : _transitionTargets);
+    _transitionToLod = toLod;
+    _lod = false;
+
+    Debug{} << "Level of detail" << (toLod ? "enabled" : "disabled");
+}
+
+void MyApplication::updateLod() {
+    const LayoutFrame& frame = _layout->frame();
+    if(!_layout->hasNewLod()) return;
+
+    /* Clusters of a rebuilt LOD are elsewhere, so move the nodes from where
+       the current one shows them. One already moving towards the LOD just
+       gets the new targets. */
+    const bool shown = _lod && !_transition.isRunning();
+    if(shown) {
+        arrayResize(_transitionTargets, NoInit, frame.positions.size());
+        _layout->lod().nodePositions(_zoom, frame.positions, _transitionTargets);
+        _transition.start(_transitionTargets);
+        _transitionToLod = true;
+        _lod = false;
+    }
+    _layout->updateLod();
+    if(shown || (_transition.isRunning() && _transitionToLod)) {
+        arrayResize(_transitionTargets, NoInit, frame.positions.size());
+        _layout->lod().nodePositions(_zoom, frame.positions, _transitionTargets);
+    }
+}
+
+void MyApplication::updateBundles() {
+    const LayoutFrame& frame = _layout->frame();
+
+    if(_pendingBundles.valid() && _pendingBundles.wait_for(std::chrono::seconds{0}) == std::future_status::ready) {
+        const EdgeBundles bundles = _pendingBundles.get();
+        _bundleBuffer.setData(bundles.points(), GL::BufferUsage::StaticDraw);
+        _bundlePointsPerEdge = bundles.pointsPerEdge();
+        _bundlesTick = _pendingBundlesTick;
+        _profiler->counters().uploadedBytes += bundles.points().size()*sizeof(Vector2);
+    }
+
+    /* Takes seconds on large graphs, so only once the positions stay put.
+       Works on a copy, the frame gets reused by the layout thread. */
+    if(!_bundling || frame.active || _bundlesTick == frame.tick || _pendingBundles.valid())
+        return;
+    Containers::Array<Vector2> positions{NoInit, frame.positions.size()};
+    Utility::copy(frame.positions, positions);
+    _pendingBundlesTick = frame.tick;
+    _pendingBundles = std::async(std::launch::async, [](Containers::Array<Vector2>&& positions, Containers::ArrayView<const Vector2ui> edges) {
+        EdgeBundles bundles;
+        bundles.build(positions, edges);
+        return bundles;
+    }, std::move(positions), Containers::arrayView(_graph.edges));
+}
+
+bool MyApplication::isBundled() const {
+    return _bundling && !_lod && !_transition.isRunning() && _bundlesTick == _layout->frame().tick;
+}
+
+void MyApplication::updateVisible() {
+    const Range2D visible = visibleRange();
+    const LayoutFrame& frame = _layout->frame();
+    const Containers::ArrayView<const Vector2> transitionTargets = _transitionToLod ?
+        Containers::arrayView(_transitionTargets) : Containers::arrayView(frame.positions);
+    if(_transition.isRunning() && _transition.advance(_timeline.previousFrameTime(), transitionTargets)) {
+        collectAll(_transition.positions());
+    } else {
+        if(_transitionToLod) {
+            _lod = true;
+            _transitionToLod = false;
+        }
+        if(_lod) collectLod(visible);
+        else collectCulled(visible);
+    }
+
+    _nodeInstanceBuffer.setData(_nodeInstances, GL::BufferUsage::StreamDraw);
+    _nodeMesh.setInstanceCount(_nodeInstances.size());
+
+    /* Bundles are already on the GPU, just pick the strips of visible
+       edges. Culled by the straight segment, so a bundle bending into view
+       from an off-screen edge can be missing until it's reached. */
+    std::size_t uploadedEdges = 0;
+    if(isBundled()) {
+        arrayResize(_bundleCounts, DirectInit, _visibleEdges.size(), _bundlePointsPerEdge);
+        arrayResize(_bundleOffsets, NoInit, _visibleEdges.size());
+        for(std::size_t i = 0; i != _visibleEdges.size(); ++i)
+            _bundleOffsets[i] = _visibleEdges[i]*_bundlePointsPerEdge;
+    } else {
+        _edgeBuffer.setData(_edgeInstances, GL::BufferUsage::StreamDraw);
+        _edgeMesh.setInstanceCount(_edgeInstances.size());
+        uploadedEdges = _edgeInstances.size();
+    }
+
+    ViewerProfiler::Counters& counters = _profiler->counters();
+    counters.uploadedBytes += _nodeInstances.size()*sizeof(NodeInstance) + uploadedEdges*sizeof(EdgeInstance);
+    counters.visibleNodes = _nodeInstances.size();
+    counters.visibleEdges = isBundled() ? _visibleEdges.size() : _edgeInstances.size();
+
+    /* Only plain nodes get labels, not clusters. The labels are rebuilt only
+       if the candidates, zoom bucket or positions changed. */
+    if(_labels && !_transition.isRunning()) {
+        if(_lod) {
+            arrayResize(_labelCandidates, NoInit, 0);
+            for(const UnsignedInt id: _lodDrawList.nodeIds)
+                if(id != ~0u) arrayAppend(_labelCandidates, id);
+        }
+        if(_labels->update(_lod ? _labelCandidates : _visibleNodes, frame.positions,
+            _graph.tags, _labelPriorities, visible, _zoom, frame.tick))
+            counters.uploadedBytes += _labels->dataSize();
+        counters.labels = _labels->labelCount();
+    }
+}
+
+void MyApplication::drawGraph(const Matrix3& transformationProjection) {
+    /* The result of a pick issued a frame or two ago, if it's done */
+    if(_gpuPicking) {
+        if(_pickRequested) {
+            _picker->pick(_nodeMesh, transformationProjection, windowSize(), _pickPosition);
+            _pickRequested = false;
+        }
+        if(Containers::Optional<Int> picked = _picker->result())
+            _hovered = *picked;
+    }
+    if(isBundled()) _bundleShader
+        .setTransformationProjectionMatrix(transformationProjection)
+        .draw(_bundleMesh, _bundleCounts, _bundleOffsets, nullptr);
+    else {
+        _transformationProjectionUniform.setData({
+            Shaders::TransformationProjectionUniform2D{}
+                .setTransformationProjectionMatrix(transformationProjection)
+        }, GL::BufferUsage::StreamDraw);
+        _edgeShader
+            .bindTransformationProjectionBuffer(_transformationProjectionUniform)
+            .bindDrawBuffer(_edgeDrawUniform)
+            .draw(_edgeMesh);
+    }
+    _nodeShader.setTransformationProjectionMatrix(transformationProjection)
+        .draw(_nodeMesh);
+    if(_labels && !_transition.isRunning()) _labels->draw(transformationProjection);
 }
 
 void MyApplication::drawEvent() {
+    _profiler->beginFrame();
+    /* At the start and not after the swap, as frames are drawn only on
+       change and transitions need the time of this one */
+    _timeline.nextFrame();
+
     GL::defaultFramebuffer.clear(GL::FramebufferClear::Color);
 
-    /* TODO: Add your drawing code here */
+    /* Never waits for the simulation, just takes whatever is newest. Frames
+       are drawn only when something changed, so the visible set is
+       collected every time. */
+    _layout->updateFrame();
+    updateLod();
+    _profiler->counters().layoutStepDuration = _layout->frame().stepDuration;
+    updateBundles();
+    if(!_densityView) updateVisible();
+
+    const Matrix3 transformationProjection =
+        Matrix3::projection(Vector2{windowSize()})*
+        Matrix3::translation(_translation)*
+        Matrix3::scaling(Vector2{_zoom});
+
+    /* The density view splats every node, there's nothing to cull or
+       collect */
+    if(_densityView) {
+        _density->draw(_layout->frame().positions, transformationProjection);
+        ViewerProfiler::Counters& counters = _profiler->counters();
+        counters.uploadedBytes += _density->dataSize();
+        counters.visibleNodes = _graph.nodeCount();
+        counters.visibleEdges = 0;
+        counters.labels = 0;
+    } else drawGraph(transformationProjection);
+
+    if(_hovered != -1) _highlightShader
+        .setTransformationProjectionMatrix(transformationProjection*
+            Matrix3::translation(_layout->frame().positions[_hovered])*
+            Matrix3::scaling(Vector2{NodeRadius*1.75f}))
+        .draw(_hoverMesh);
+    if(_selecting) _highlightShader
+        .setTransformationProjectionMatrix(transformationProjection*
+            Matrix3::translation(_selectionRange.center())*
+            Matrix3::scaling(_selectionRange.size()*0.5f))
+        .draw(_selectionMesh);
+
+    _profiler->drawOverlay(windowSize());
+    _profiler->endFrame();
 
     swapBuffers();
+
+    /* The profiler needs a steady stream of frames to say anything useful */
+    if(_layout->frame().active || _dragged != -1 || (_gpuPicking && _picker->isPending()) || _profiler->isEnabled() || _pendingBundles.valid() || _transition.isRunning())
+        redraw();
+}
+
+void MyApplication::viewportEvent(ViewportEvent& event) {
+    GL::defaultFramebuffer.setViewport({{}, event.framebufferSize()});
+    _edgeDrawUniform.setData({EdgeDrawUniform{Vector2{event.framebufferSize()}}});
+    if(_density) _density->setViewport(event.framebufferSize());
+    redraw();
+}
+
+Vector2 MyApplication::windowToWorld(const Vector2i& position) const {
+    const Vector2 centered{position.x() - windowSize().x()*0.5f,
+                           windowSize().y()*0.5f - position.y()};
+    return (centered - _translation)/_zoom;
+}
+
+void MyApplication::select(const Range2D& range) {
+    for(const UnsignedInt i: _selection) _selected[i] = false;
+    arrayResize(_selection, NoInit, 0);
+    _layout->frame().grid.within(range, _selection);
+    for(const UnsignedInt i: _selection) _selected[i] = true;
+}
+
+void MyApplication::mousePressEvent(MouseEvent& event) {
+    if(event.button() != MouseEvent::Button::Left) return;
+
+    const Vector2 position = windowToWorld(event.position());
+
+    /* Shift-drag selects nodes in a rectangle */
+    if(event.modifiers() & MouseEvent::Modifier::Shift) {
+        _selecting = true;
+        _selectionStart = position;
+        _selectionRange = {position, position};
+        select(_selectionRange);
+        event.setAccepted();
+        redraw();
+        return;
+    }
+
+    /* With GPU picking the press lands on whatever was hovered last */
+    _dragged = _gpuPicking ? _hovered :
+        _layout->frame().grid.nearest(position, NodeRadius);
+    if(_dragged != -1) {
+        _dragOffset = _layout->frame().positions[_dragged] - position;
+        _layout->setAlphaTarget(0.3f);
+        _layout->pin(_dragged, position + _dragOffset);
+    }
+
+    event.setAccepted();
+    redraw();
+}
+
+void MyApplication::mouseReleaseEvent(MouseEvent& event) {
+    if(event.button() != MouseEvent::Button::Left) return;
+
+    if(_dragged != -1) {
+        _layout->setAlphaTarget(0.0f);
+        _layout->unpin(_dragged);
+        _dragged = -1;
+    }
+    _selecting = false;
+
+    event.setAccepted();
+    redraw();
+}
+
+void MyApplication::mouseMoveEvent(MouseMoveEvent& event) {
+    if(!(event.buttons() & MouseMoveEvent::Button::Left)) {
+        if(_gpuPicking) {
+            _pickPosition = event.position();
+            _pickRequested = true;
+            redraw();
+            return;
+        }
+
+        const Int hovered = _layout->frame().grid.nearest(windowToWorld(event.position()), NodeRadius);
+        if(hovered != _hovered) {
+            _hovered = hovered;
+            redraw();
+        }
+        return;
+    }
+
+    if(_selecting) {
+        const Vector2 position = windowToWorld(event.position());
+        _selectionRange = {Math::min(_selectionStart, position),
+                           Math::max(_selectionStart, position)};
+        select(_selectionRange);
+    } else if(_dragged != -1)
+        _layout->pin(_dragged, windowToWorld(event.position()) + _dragOffset);
+    else
+        _translation += Vector2{event.relativePosition()}*Vector2{1.0f, -1.0f};
+
+    event.setAccepted();
+    redraw();
+}
+
+void MyApplication::mouseScrollEvent(MouseScrollEvent& event) {
+    /* Zoom around the cursor, keeping the point under it in place */
+    const Vector2 position = windowToWorld(event.position());
+    _zoom = Math::clamp(_zoom*(1.0f + 0.1f*event.offset().y()), 0.01f, 100.0f);
+    _translation = (windowToWorld(event.position()) - position)*_zoom + _translation;
+
+    event.setAccepted();
+    redraw();
+}
+
+void MyApplication::keyPressEvent(KeyEvent& event) {
+    if(event.key() == KeyEvent::Key::P) {
+        _gpuPicking = !_gpuPicking;
+        if(_gpuPicking && !_picker) _picker.emplace();
+        Debug{} << "GPU picking" << (_gpuPicking ? "enabled" : "disabled");
+    } else if(event.key() == KeyEvent::Key::L) {
+        toggleLod();
+    } else if(event.key() == KeyEvent::Key::B) {
+        _bundling = !_bundling;
+        Debug{} << "Edge bundling" << (_bundling ? "enabled" : "disabled");
+    } else if(event.key() == KeyEvent::Key::H) {
+        _densityView = !_densityView;
+        if(_densityView && !_density) _density.emplace(_graph, framebufferSize());
+        Debug{} << "Density view" << (_densityView ? "enabled" : "disabled");
+    } else if(event.key() == KeyEvent::Key::F) {
+        if(_profiler->isEnabled()) _profiler->disable();
+        else _profiler->enable();
+        Debug{} << "Profiler" << (_profiler->isEnabled() ? "enabled" : "disabled");
+    } else return;
+
+    event.setAccepted();
+    redraw();
 }
 
 MAGNUM_APPLICATION_MAIN(MyApplication)
@@ -0,0 +1,80 @@
+#include "ObjectIdPicker.h"
+
+#include <cstring>
+#include <Corrade/Containers/Array.h>
+#include <Magnum/GL/DefaultFramebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/Math/Range.h>
+
+namespace Breadcrumbs {
+
+ObjectIdPicker::ObjectIdPicker(): _framebuffer{{{}, Vector2i{1}}}, _shader{
+    Shaders::FlatGL2D::Flag::InstancedTransformation|
+    Shaders::FlatGL2D::Flag::InstancedObjectId}
+{
+    _objectId.setStorage(GL::RenderbufferFormat::R32UI, Vector2i{1});
+    _framebuffer.attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, _objectId)
+        .mapForDraw({{Shaders::FlatGL2D::ObjectIdOutput, GL::Framebuffer::ColorAttachment{0}}})
+        .mapForRead(GL::Framebuffer::ColorAttachment{0});
+}
+
+ObjectIdPicker::~ObjectIdPicker() {
+    for(Readback& readback: _readbacks)
+        if(readback.fence) glDeleteSync(readback.fence);
+}
+
+void ObjectIdPicker::pick(GL::Mesh& mesh, const Matrix3& transformationProjection, const Vector2i& windowSize, const Vector2i& position) {
+    Readback& readback = _readbacks[_next];
+    if(readback.fence) return;
+
+    /* Like gluPickMatrix(), blows the pixel under the cursor up to the whole
+       viewport */
+    const Vector2 size{windowSize};
+    const Vector2 center{(position.x() + 0.5f)/size.x()*2.0f - 1.0f,
+                         1.0f - (position.y() + 0.5f)/size.y()*2.0f};
+    const Matrix3 pickMatrix = Matrix3::scaling(size)*Matrix3::translation(-center);
+
+    _framebuffer
+        .clearColor(Shaders::FlatGL2D::ObjectIdOutput, Vector4ui{})
+        .bind();
+    _shader.setTransformationProjectionMatrix(pickMatrix*transformationProjection)
+        .draw(mesh);
+    _framebuffer.read({{}, Vector2i{1}}, readback.image, GL::BufferUsage::StreamRead);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    GL::defaultFramebuffer.bind();
+
+    _next = (_next + 1) % Containers::arraySize(_readbacks);
+}
+
+Containers::Optional<Int> ObjectIdPicker::result() {
+    Containers::Optional<Int> out;
+
+    /* Oldest first, stopping at the first that's not done yet so results
+       are never reported out of order */
+    for(std::size_t i = 0; i != Containers::arraySize(_readbacks); ++i) {
+        Readback& readback = _readbacks[(_next + i) % Containers::arraySize(_readbacks)];
+        if(!readback.fence) continue;
+
+        const GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if(status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) break;
+        glDeleteSync(readback.fence);
+        readback.fence = {};
+
+        /* The copy is done, so this doesn't wait either */
+        const Containers::Array<char> data = readback.image.buffer().data();
+        UnsignedInt id;
+        std::memcpy(&id, data.data(), sizeof(UnsignedInt));
+        out = Int(id) - 1;
+    }
+
+    return out;
+}
+
+bool ObjectIdPicker::isPending() const {
+    for(const Readback& readback: _readbacks)
+        if(readback.fence) return true;
+    return false;
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef ObjectIdPicker_h
+#define ObjectIdPicker_h
+
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/GL/BufferImage.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/PixelFormat.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Shaders/FlatGL.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* GPU picking. Node instances are drawn with their IDs into a single-pixel
+   integer framebuffer, with the projection narrowed down to the pixel under
+   the cursor, so only that one pixel is ever rasterized. The result is read
+   into a pixel pack buffer and fetched a frame or two later once its fence
+   signals, so the pipeline is never stalled.
+
+   The mesh is expected to have an instanced Shaders::FlatGL2D::ObjectId
+   attribute containing the node ID plus one, 0 is the background. */
+class ObjectIdPicker {
+    public:
+        explicit ObjectIdPicker();
+
+        ~ObjectIdPicker();
+
+        ObjectIdPicker(const ObjectIdPicker&) = delete;
+        ObjectIdPicker& operator=(const ObjectIdPicker&) = delete;
+
+        /* Queues a pick at given window position. Does nothing if all
+           readbacks are still in flight. Leaves the default framebuffer
+           bound. */
+        void pick(GL::Mesh& mesh, const Matrix3& transformationProjection, const Vector2i& windowSize, const Vector2i& position);
+
+        /* Newest finished pick, if any finished since the last call. -1 if
+           there was no node at the position. Never waits. */
+        Containers::Optional<Int> result();
+
+        /* Whether there are picks that didn't finish yet */
+        bool isPending() const;
+
+    private:
+        struct Readback {
+            GL::BufferImage2D image{GL::PixelFormat::RedInteger, GL::PixelType::UnsignedInt};
+            GLsync fence{};
+        };
+
+        GL::Renderbuffer _objectId;
+        GL::Framebuffer _framebuffer;
+        Shaders::FlatGL2D _shader;
+        Readback _readbacks[2];
+        /* Next slot to issue into, the other is the older one */
+        std::size_t _next{};
+};
+
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include "PositionTransition.h"
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Magnum/Animation/Easing.h>
+
+namespace Breadcrumbs {
+
+PositionTransition::PositionTransition(const Float duration): _track{
+    {{0.0f, 0.0f}, {duration, 1.0f}},
+    Animation::ease<Float, Math::lerp, Animation::Easing::smootherstep>(),
+    Animation::Extrapolation::Constant}
+{
+    _player.add(_track, _progress);
+}
+
+void PositionTransition::start(const Containers::ArrayView<const Vector2> from) {
+    /* From can be positions(), so copy it away first */
+    arrayResize(_from, NoInit, from.size());
+    Utility::copy(from, _from);
+    arrayResize(_positions, NoInit, from.size());
+    Utility::copy(_from, _positions);
+    _player.stop();
+    _progress = 0.0f;
+    _pendingPlay = true;
+}
+
+bool PositionTransition::advance(const Float time, const Containers::ArrayView<const Vector2> to) {
+    if(_pendingPlay) {
+        _player.play(time);
+        _pendingPlay = false;
+    }
+    _player.advance(time);
+
+    /* Blended as flat float arrays, which the compiler turns into a SIMD
+       loop */
+    const Float t = _progress;
+    const Containers::ArrayView<const Float> from = Containers::arrayCast<const Float>(_from);
+    const Containers::ArrayView<const Float> target = Containers::arrayCast<const Float>(to);
+    const Containers::ArrayView<Float> out = Containers::arrayCast<Float>(_positions);
+    for(std::size_t i = 0; i != out.size(); ++i)
+        out[i] = from[i] + (target[i] - from[i])*t;
+
+    return _player.state() == Animation::State::Playing;
+}
+
+}
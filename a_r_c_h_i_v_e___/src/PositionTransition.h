@@ -0,0 +1,57 @@
+#ifndef PositionTransition_h
+#define PositionTransition_h
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Animation/Player.h>
+#include <Magnum/Animation/Track.h>
+#include <Magnum/Math/Vector2.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Animated move of all nodes from one set of positions to another. Every
+   node has the same two keyframes at the same times, so instead of a track
+   and a player callback per node there's one Animation::Player driving a
+   single eased progress track, and the node keyframes are two plain arrays
+   blended in one pass the compiler can vectorize. That keeps 10^5 nodes at
+   well under a millisecond per frame.
+
+   Targets are passed to every advance() and not stored, so a transition
+   can end at positions that are still moving. */
+class PositionTransition {
+    public:
+        explicit PositionTransition(Float duration = 0.5f);
+
+        PositionTransition(const PositionTransition&) = delete;
+        PositionTransition& operator=(const PositionTransition&) = delete;
+
+        bool isRunning() const {
+            return _player.state() == Animation::State::Playing || _pendingPlay;
+        }
+
+        /* Starts from given positions, which can be positions() to turn
+           around in the middle of a transition. The clock starts at the
+           next advance(), so one started between frames doesn't skip
+           ahead. */
+        void start(Containers::ArrayView<const Vector2> from);
+
+        /* Interpolates towards the targets at given time, which has to have
+           the same size as what was passed to start(). Returns false once
+           the transition finished, positions() are equal to the targets
+           then. */
+        bool advance(Float time, Containers::ArrayView<const Vector2> to);
+
+        Containers::ArrayView<const Vector2> positions() const { return _positions; }
+
+    private:
+        Animation::Track<Float, Float> _track;
+        Animation::Player<Float> _player;
+        Float _progress{};
+        bool _pendingPlay{};
+        Containers::Array<Vector2> _from, _positions;
+};
+
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+
+namespace Breadcrumbs {
+
+namespace {
+
+/* Don't let coincident nodes explode the cell count */
+constexpr Float MinCellSize = 1.0f;
+constexpr Int MaxCellsPerSide = 1 << 15;
+
+}
+
+void SpatialGrid::build(const Containers::ArrayView<const Vector2> positions) {
+    const std::size_t count = positions.size();
+    arrayResize(_ids, NoInit, count);
+    arrayResize(_positions, NoInit, count);
+
+    if(!count) {
+        _bounds = {};
+        _size = {};
+        arrayResize(_cellOffsets, ValueInit, 1);
+        return;
+    }
+
+    Vector2 min = positions[0], max = positions[0];
+    for(const Vector2& position: positions) {
+        min = Math::min(min, position);
+        max = Math::max(max, position);
+    }
+    _bounds = {min, max};
+
+    /* About one node per cell on average */
+    const Vector2 size = Math::max(max - min, Vector2{MinCellSize});
+    _cellSize = Math::max(std::sqrt(size.product()/count), MinCellSize);
+    _size = Math::clamp(Vector2i{Math::floor(size/_cellSize)} + Vector2i{1}, Vector2i{1}, Vector2i{MaxCellsPerSide});
+    _cellSize = Math::max(_cellSize, (size/Vector2{_size}).max());
+    const std::size_t cellCount = std::size_t(_size.x())*_size.y();
+
+    /* Counting sort into cells. The first pass counts into offsets shifted
+       by one, the prefix sum then turns them into cell begins. */
+    arrayResize(_cellOffsets, NoInit, cellCount + 1);
+    std::fill(_cellOffsets.begin(), _cellOffsets.end(), 0u);
+    for(const Vector2& position: positions)
+        ++_cellOffsets[cellIndex(cellOf(position)) + 1];
+    for(std::size_t i = 1; i <= cellCount; ++i)
+        _cellOffsets[i] += _cellOffsets[i - 1];
+    for(std::size_t i = 0; i != count; ++i) {
+        const UnsignedInt to = _cellOffsets[cellIndex(cellOf(positions[i]))]++;
+        _ids[to] = i;
+        _positions[to] = positions[i];
+    }
+    /* The scatter advanced every begin to the next cell's begin, shift back */
+    for(std::size_t i = cellCount; i != 0; --i)
+        _cellOffsets[i] = _cellOffsets[i - 1];
+    _cellOffsets[0] = 0;
+}
+
+Vector2i SpatialGrid::cellOf(const Vector2& position) const {
+    return Math::clamp(Vector2i{Math::floor((position - _bounds.min())/_cellSize)}, Vector2i{0}, _size - Vector2i{1});
+}
+
+Int SpatialGrid::nearest(const Vector2& position, const Float radius) const {
+    if(_ids.isEmpty()) return -1;
+
+    const Vector2i min = cellOf(position - Vector2{radius});
+    const Vector2i max = cellOf(position + Vector2{radius});
+    Int found = -1;
+    Float nearest = radius*radius;
+    for(Int y = min.y(); y <= max.y(); ++y) {
+        for(Int x = min.x(); x <= max.x(); ++x) {
+            const std::size_t cell = cellIndex({x, y});
+            for(UnsignedInt i = _cellOffsets[cell]; i != _cellOffsets[cell + 1]; ++i) {
+                const Float distance = (_positions[i] - position).dot();
+                if(distance < nearest) {
+                    nearest = distance;
+                    found = _ids[i];
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+void SpatialGrid::within(const Range2D& range, Containers::Array<UnsignedInt>& out) const {
+    if(_ids.isEmpty() || !Math::intersects(range, _bounds)) return;
+
+    const Vector2i min = cellOf(range.min());
+    const Vector2i max = cellOf(range.max());
+    for(Int y = min.y(); y <= max.y(); ++y) {
+        for(Int x = min.x(); x <= max.x(); ++x) {
+            const std::size_t cell = cellIndex({x, y});
+            /* Cells fully inside don't need the per-point test */
+            const Range2D cellRange = Range2D::fromSize(_bounds.min() + Vector2{Vector2i{x, y}}*_cellSize, Vector2{_cellSize});
+            const bool inside = x != min.x() && x != max.x() && y != min.y() && y != max.y() && range.contains(cellRange);
+            for(UnsignedInt i = _cellOffsets[cell]; i != _cellOffsets[cell + 1]; ++i)
+                if(inside || range.contains(_positions[i]))
+                    arrayAppend(out, _ids[i]);
+        }
+    }
+}
+
+void SpatialGrid::nearest(const Vector2& position, const std::size_t k, Containers::Array<UnsignedInt>& out) const {
+    arrayResize(out, NoInit, 0);
+    if(_ids.isEmpty() || !k) return;
+
+    /* Max-heap of (distance, id) holding the best k so far */
+    std::vector<std::pair<Float, UnsignedInt>> heap;
+    heap.reserve(k + 1);
+
+    const auto visit = [&](const Vector2i& cell) {
+        const std::size_t index = cellIndex(cell);
+        for(UnsignedInt i = _cellOffsets[index]; i != _cellOffsets[index + 1]; ++i) {
+            const Float distance = (_positions[i] - position).dot();
+            if(heap.size() < k) {
+                heap.emplace_back(distance, _ids[i]);
+                std::push_heap(heap.begin(), heap.end());
+            } else if(distance < heap.front().first) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = {distance, _ids[i]};
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+    };
+
+    const Vector2i center = cellOf(position);
+    for(Int ring = 0; ; ++ring) {
+        const Vector2i min = center - Vector2i{ring};
+        const Vector2i max = center + Vector2i{ring};
+
+        /* Only the border of the ring, the inside was visited already */
+        for(Int y = Math::max(min.y(), 0); y <= Math::min(max.y(), _size.y() - 1); ++y) {
+            if(y == min.y() || y == max.y()) {
+                for(Int x = Math::max(min.x(), 0); x <= Math::min(max.x(), _size.x() - 1); ++x)
+                    visit({x, y});
+            } else {
+                if(min.x() >= 0) visit({min.x(), y});
+                if(max.x() < _size.x()) visit({max.x(), y});
+            }
+        }
+
+        /* Everything not visited yet is outside the square of visited
+           cells. Stop once the k-th best is closer than the nearest side of
+           that square that still has cells beyond it, or once there are no
+           such sides left. */
+        if(min.x() <= 0 && min.y() <= 0 && max.x() >= _size.x() - 1 && max.y() >= _size.y() - 1)
+            break;
+        if(heap.size() == k) {
+            const Vector2 visitedMin = _bounds.min() + Vector2{min}*_cellSize;
+            const Vector2 visitedMax = _bounds.min() + Vector2{max + Vector2i{1}}*_cellSize;
+            Float edge = Constants::inf();
+            if(min.x() > 0) edge = Math::min(edge, position.x() - visitedMin.x());
+            if(min.y() > 0) edge = Math::min(edge, position.y() - visitedMin.y());
+            if(max.x() < _size.x() - 1) edge = Math::min(edge, visitedMax.x() - position.x());
+            if(max.y() < _size.y() - 1) edge = Math::min(edge, visitedMax.y() - position.y());
+            edge = Math::max(edge, 0.0f);
+            if(heap.front().first <= edge*edge) break;
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+    arrayResize(out, NoInit, heap.size());
+    for(std::size_t i = 0; i != heap.size(); ++i)
+        out[i] = heap[i].second;
+}
+
+}
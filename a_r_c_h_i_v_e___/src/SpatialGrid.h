@@ -0,0 +1,56 @@
+#ifndef SpatialGrid_h
+#define SpatialGrid_h
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Range.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Uniform grid over node positions, rebuilt from scratch with a counting
+   sort in O(n). Cell size adapts to the point density so there's about one
+   node per cell, which keeps point picking and hover O(1) and rectangle
+   and k-nearest queries proportional to the output. Storage is reused
+   across rebuilds, so a steady-state rebuild doesn't allocate. */
+class SpatialGrid {
+    public:
+        explicit SpatialGrid() = default;
+
+        void build(Containers::ArrayView<const Vector2> positions);
+
+        std::size_t pointCount() const { return _ids.size(); }
+        const Range2D& bounds() const { return _bounds; }
+        Float cellSize() const { return _cellSize; }
+
+        /* Closest node within given radius, -1 if there's none. Same as
+           simulation.find() in d3. */
+        Int nearest(const Vector2& position, Float radius) const;
+
+        /* Appends all nodes inside given rectangle to out */
+        void within(const Range2D& range, Containers::Array<UnsignedInt>& out) const;
+
+        /* Replaces the contents of out with up to k closest nodes, ordered
+           from the nearest */
+        void nearest(const Vector2& position, std::size_t k, Containers::Array<UnsignedInt>& out) const;
+
+    private:
+        Vector2i cellOf(const Vector2& position) const;
+        std::size_t cellIndex(const Vector2i& cell) const {
+            return std::size_t(cell.y())*_size.x() + cell.x();
+        }
+
+        Range2D _bounds;
+        Float _cellSize{1.0f};
+        Vector2i _size;
+        /* Per-cell ranges into _ids and _positions, which are sorted by
+           cell so queries walk contiguous memory */
+        Containers::Array<UnsignedInt> _cellOffsets;
+        Containers::Array<UnsignedInt> _ids;
+        Containers::Array<Vector2> _positions;
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SpscQueue_h
+#define SpscQueue_h
+
+#include <atomic>
+#include <cstddef>
+
+namespace Breadcrumbs {
+
+/* Bounded lock-free single-producer single-consumer ring buffer. Capacity
+   has to be a power of two; push() fails instead of blocking when full. */
+template<class T, std::size_t capacity> class SpscQueue {
+    static_assert(capacity && !(capacity & (capacity - 1)), "capacity has to be a power of two");
+
+    public:
+        /* Producer side */
+        bool push(const T& value) {
+            const std::size_t tail = _tail.load(std::memory_order_relaxed);
+            if(tail - _head.load(std::memory_order_acquire) == capacity)
+                return false;
+            _data[tail & (capacity - 1)] = value;
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /* Consumer side */
+        bool pop(T& value) {
+            const std::size_t head = _head.load(std::memory_order_relaxed);
+            if(head == _tail.load(std::memory_order_acquire))
+                return false;
+            value = _data[head & (capacity - 1)];
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        T _data[capacity];
+        /* Padded apart so the two sides don't false-share a cache line.
+           Not using alignas(64), as C++11 operator new doesn't honor
+           extended alignment for heap-allocated owners. */
+        std::atomic<std::size_t> _head{0};
+        char _padding[64];
+        std::atomic<std::size_t> _tail{0};
+};
+
+}
+
+#endif
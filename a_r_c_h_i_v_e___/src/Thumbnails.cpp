@@ -0,0 +1,231 @@
+#include <unordered_map>
+#include <unordered_set>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pair.h>
+#include <Corrade/Containers/StringStl.h>
+#include <Corrade/PluginManager/Manager.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/DebugStl.h>
+#include <Corrade/Utility/Path.h>
+#include <Magnum/DebugTools/Screenshot.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/Platform/WindowlessEglApplication.h>
+#include <Magnum/Primitives/Circle.h>
+#include <Magnum/Shaders/FlatGL.h>
+#include <Magnum/Trade/AbstractImageConverter.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "ForceLayout.h"
+#include "GraphData.h"
+#include "GraphStyle.h"
+#include "readfile.h"
+
+using namespace Magnum;
+using namespace Breadcrumbs;
+
+/* Renders "history map" previews of many graphs in one go, without a
+   display. One GL context, one set of framebuffers and one set of meshes is
+   made up front and reused for every input, so the per-graph cost is just
+   the layout and a single draw. Works with Mesa llvmpipe. */
+class Thumbnails: public Platform::WindowlessApplication {
+    public:
+        explicit Thumbnails(const Arguments& arguments);
+
+        int exec() override;
+
+    private:
+        bool render(const std::string& input, const std::string& output);
+
+        Utility::Arguments _args;
+        Int _size;
+        UnsignedInt _maxTicks;
+
+        /* Created only after the arguments are parsed and there's a
+           context. Drawn multisampled, then resolved for the screenshot. */
+        GL::Renderbuffer _multisampleColor{NoCreate}, _color{NoCreate};
+        GL::Framebuffer _multisampleFramebuffer{NoCreate}, _framebuffer{NoCreate};
+
+        GL::Buffer _nodeInstanceBuffer{NoCreate}, _positionBuffer{NoCreate}, _edgeIndexBuffer{NoCreate};
+        GL::Mesh _nodeMesh{NoCreate}, _edgeMesh{NoCreate};
+        Shaders::FlatGL2D _nodeShader{NoCreate}, _edgeShader{NoCreate};
+        Containers::Array<NodeInstance> _nodeInstances;
+
+        PluginManager::Manager<Trade::AbstractImageConverter> _converterManager;
+};
+
+Thumbnails::Thumbnails(const Arguments& arguments): Platform::WindowlessApplication{arguments, NoCreate} {
+    _args.addArrayArgument("input").setHelp("input", "visit history files, one tag and link per line")
+        .addOption('o', "output", ".").setHelp("output", "output directory", "DIR")
+        .addOption("size", "512").setHelp("size", "thumbnail size in pixels", "N")
+        .addOption("format", "tga").setHelp("format", "output file extension, picks the image converter. Formats other than tga need the converter plugin from magnum-plugins.", "EXT")
+        .addOption("max-ticks", "1000").setHelp("max-ticks", "stop the layout after this many ticks even if it didn't settle", "N")
+        .addSkippedPrefix("magnum", "engine-specific options")
+        .setGlobalHelp("Lays out visit histories and renders their thumbnails without a display.")
+        .parse(arguments.argc, arguments.argv);
+
+    createContext();
+
+    _size = _args.value<Int>("size");
+    _maxTicks = _args.value<UnsignedInt>("max-ticks");
+
+    _multisampleColor = GL::Renderbuffer{};
+    _color = GL::Renderbuffer{};
+    _multisampleColor.setStorageMultisample(4, GL::RenderbufferFormat::RGBA8, Vector2i{_size});
+    _color.setStorage(GL::RenderbufferFormat::RGBA8, Vector2i{_size});
+    _multisampleFramebuffer = GL::Framebuffer{{{}, Vector2i{_size}}};
+    _multisampleFramebuffer.attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, _multisampleColor);
+    _framebuffer = GL::Framebuffer{{{}, Vector2i{_size}}};
+    _framebuffer.attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, _color);
+
+    GL::Renderer::setClearColor(BackgroundColor);
+    GL::Renderer::enable(GL::Renderer::Feature::Blending);
+    GL::Renderer::setBlendFunction(GL::Renderer::BlendFunction::SourceAlpha,
+        GL::Renderer::BlendFunction::OneMinusSourceAlpha);
+
+    /* Same look as the viewer */
+    _nodeInstanceBuffer = GL::Buffer{};
+    _positionBuffer = GL::Buffer{};
+    _edgeIndexBuffer = GL::Buffer{};
+    _nodeMesh = MeshTools::compile(Primitives::circle2DSolid(16));
+    _nodeMesh.addVertexBufferInstanced(_nodeInstanceBuffer, 1, 0,
+        Shaders::FlatGL2D::TransformationMatrix{},
+        Shaders::FlatGL2D::Color3{},
+        Shaders::FlatGL2D::ObjectId{});
+    _nodeShader = Shaders::FlatGL2D{
+        Shaders::FlatGL2D::Flag::InstancedTransformation|
+        Shaders::FlatGL2D::Flag::VertexColor};
+    _edgeMesh = GL::Mesh{};
+    _edgeMesh.setPrimitive(GL::MeshPrimitive::Lines)
+        .addVertexBuffer(_positionBuffer, 0, Shaders::FlatGL2D::Position{})
+        .setIndexBuffer(_edgeIndexBuffer, 0, GL::MeshIndexType::UnsignedInt);
+    _edgeShader = Shaders::FlatGL2D{};
+    _edgeShader.setColor(EdgeColor);
+}
+
+bool Thumbnails::render(const std::string& input, const std::string& output) {
+    /* ReadFile() exits on failure, which would end the whole batch */
+    if(!Utility::Path::exists(input)) {
+        Error{} << "Can't open" << input;
+        return false;
+    }
+
+    Wgraph wgraph;
+    ReadFile(input, wgraph);
+    const GraphData graph = graphDataFromWgraph(wgraph);
+    if(!graph.nodeCount()) {
+        Warning{} << "Skipping" << input << Debug::nospace << ", no visits";
+        return false;
+    }
+
+    ForceLayout layout{graph.nodeCount(), graph.edges};
+    UnsignedInt ticks = 0;
+    while(layout.isActive() && ticks != _maxTicks) {
+        layout.step();
+        ++ticks;
+    }
+    const Containers::ArrayView<const Vector2> positions = layout.positions();
+
+    /* Fit the whole graph, with a margin of one node */
+    Vector2 min = positions[0], max = positions[0];
+    for(const Vector2& position: positions) {
+        min = Math::min(min, position);
+        max = Math::max(max, position);
+    }
+    const Range2D bounds{min, max};
+    const Vector2 size = bounds.size() + Vector2{NodeRadius*4.0f};
+    const Matrix3 transformationProjection =
+        Matrix3::projection(Vector2{size.max()})*
+        Matrix3::translation(-bounds.center());
+
+    _nodeInstances = Containers::Array<NodeInstance>{NoInit, graph.nodeCount()};
+    const Matrix3 scaling = Matrix3::scaling(Vector2{NodeRadius});
+    for(std::size_t i = 0; i != graph.nodeCount(); ++i)
+        _nodeInstances[i] = {Matrix3::translation(positions[i])*scaling, groupColor(graph.groups[i]), UnsignedInt(i + 1)};
+    _nodeInstanceBuffer.setData(_nodeInstances, GL::BufferUsage::StreamDraw);
+    _nodeMesh.setInstanceCount(graph.nodeCount());
+    _positionBuffer.setData(positions, GL::BufferUsage::StreamDraw);
+    _edgeIndexBuffer.setData(graph.edges, GL::BufferUsage::StreamDraw);
+    _edgeMesh.setCount(graph.edges.size()*2);
+
+    _multisampleFramebuffer
+        .clear(GL::FramebufferClear::Color)
+        .bind();
+    _edgeShader.setTransformationProjectionMatrix(transformationProjection)
+        .draw(_edgeMesh);
+    _nodeShader.setTransformationProjectionMatrix(transformationProjection)
+        .draw(_nodeMesh);
+    GL::AbstractFramebuffer::blit(_multisampleFramebuffer, _framebuffer,
+        _framebuffer.viewport(), GL::FramebufferBlit::Color);
+
+    if(!DebugTools::screenshot(_converterManager, _framebuffer, output))
+        return false;
+
+    Debug{} << input << "->" << output << Debug::nospace << ":" << graph.nodeCount() << "nodes," << ticks << "ticks";
+    return true;
+}
+
+namespace {
+
+/* Input path without the extension and the leading /, . and .. parts, with
+   the directories joined by underscores, so users/a/history.txt becomes
+   users_a_history */
+std::string pathName(const std::string& input) {
+    const std::string path = Utility::Path::splitExtension(input).first();
+    std::string name;
+    std::size_t begin = 0;
+    while(begin <= path.size()) {
+        std::size_t end = path.find_first_of("/\\", begin);
+        if(end == std::string::npos) end = path.size();
+        const std::string part = path.substr(begin, end - begin);
+        if(!part.empty() && part != "." && part != "..")
+            name += (name.empty() ? "" : "_") + part;
+        begin = end + 1;
+    }
+    return name;
+}
+
+}
+
+int Thumbnails::exec() {
+    const std::string outputDirectory = _args.value("output");
+    if(!Utility::Path::make(outputDirectory)) return 1;
+
+    /* Outputs are named after the input file, unless several inputs have
+       the same one, such as a history per user in a directory each. Those
+       get named after the whole path. */
+    const std::size_t inputCount = _args.arrayValueCount("input");
+    std::unordered_map<std::string, UnsignedInt> filenameCounts;
+    for(std::size_t i = 0; i != inputCount; ++i)
+        ++filenameCounts[Utility::Path::split(_args.arrayValue("input", i)).second()];
+
+    std::size_t failed = 0;
+    std::unordered_set<std::string> outputs;
+    for(std::size_t i = 0; i != inputCount; ++i) {
+        const std::string input = _args.arrayValue("input", i);
+        const std::string filename = Utility::Path::split(input).second();
+        const std::string name = filenameCounts[filename] == 1 ?
+            std::string{Utility::Path::splitExtension(filename).first()} : pathName(input);
+        const std::string output = Utility::Path::join(outputDirectory, name + "." + _args.value("format"));
+        /* The same input twice, or paths that differ only in the parts
+           dropped above */
+        if(!outputs.insert(output).second) {
+            Error{} << "Skipping" << input << Debug::nospace << "," << output << "is already written for another input";
+            ++failed;
+            continue;
+        }
+        if(!render(input, output))
+            ++failed;
+    }
+
+    return failed ? 1 : 0;
+}
+
+MAGNUM_WINDOWLESSAPPLICATION_MAIN(Thumbnails)
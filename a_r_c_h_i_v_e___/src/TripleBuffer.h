@@ -0,0 +1,63 @@
+#ifndef TripleBuffer_h
+#define TripleBuffer_h
+
+#include <atomic>
+#include <utility>
+#include <Magnum/Magnum.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Wait-free single-producer single-consumer handoff of the latest value. The
+   writer fills back() and publish()es it, the reader calls update() and reads
+   front(). Neither side ever waits for the other; intermediate values the
+   reader didn't get to are simply overwritten. */
+template<class T> class TripleBuffer {
+    public:
+        explicit TripleBuffer() = default;
+
+        TripleBuffer(const TripleBuffer<T>&) = delete;
+        TripleBuffer<T>& operator=(const TripleBuffer<T>&) = delete;
+
+        /* All three slots, for preallocating their contents so the writer
+           doesn't need to allocate. Only safe before either side starts. */
+        T* slots() { return _slots; }
+
+        /* Writer side */
+        T& back() { return _slots[_back]; }
+
+        void publish() {
+            _back = _middle.exchange(_back|Fresh, std::memory_order_acq_rel) & IndexMask;
+        }
+
+        /* Reader side. Returns true if front() changed since the last call. */
+        bool update() {
+            if(!(_middle.load(std::memory_order_relaxed) & Fresh)) return false;
+            _front = _middle.exchange(_front, std::memory_order_acq_rel) & IndexMask;
+            return true;
+        }
+
+        /* Reader side. Whether the next update() would change front(). */
+        bool isFresh() const {
+            return _middle.load(std::memory_order_relaxed) & Fresh;
+        }
+
+        const T& front() const { return _slots[_front]; }
+        T& front() { return _slots[_front]; }
+
+    private:
+        enum: UnsignedByte {
+            IndexMask = 0x03,
+            Fresh = 0x04
+        };
+
+        T _slots[3];
+        /* Each index is owned by exactly one side at any time */
+        UnsignedByte _back{0}, _front{1};
+        std::atomic<UnsignedByte> _middle{2};
+};
+
+}
+
+#endif
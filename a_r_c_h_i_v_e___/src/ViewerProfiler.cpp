@@ -0,0 +1,171 @@
+#include "ViewerProfiler.h"
+
+#include <Corrade/Containers/Pair.h>
+#include <Corrade/Containers/StringStl.h>
+#include <Corrade/Utility/DebugStl.h>
+#include <Corrade/Utility/Path.h>
+#include <Corrade/Utility/String.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Text/AbstractFont.h>
+#include <Magnum/Text/GlyphCache.h>
+
+namespace Breadcrumbs {
+
+using namespace Math::Literals;
+
+namespace {
+
+/* Statistics are refreshed this often, in frames */
+constexpr UnsignedInt StatisticsInterval = 30;
+
+constexpr Float OverlaySize = 14.0f;
+constexpr Vector2 OverlayMargin{8.0f};
+
+/* Counters are filled in by the viewer during the frame, so there's nothing
+   to do at the start and the end just picks the value */
+void nothing(void*) {}
+
+template<UnsignedLong ViewerProfiler::Counters::*counter> UnsignedLong value(void* state) {
+    return static_cast<const ViewerProfiler::Counters*>(state)->*counter;
+}
+
+/* Latest frame that has data for given measurement */
+bool latest(const DebugTools::FrameProfiler& profiler, const UnsignedInt id, UnsignedLong& out) {
+    if(!profiler.isMeasurementAvailable(id)) return false;
+    out = profiler.measurementData(id, Math::min(
+        profiler.measuredFrameCount() - Math::max(profiler.measurementDelay(id), 1u),
+        profiler.maxFrameCount() - 1));
+    return true;
+}
+
+/* "Layout step" -> "layout_step" */
+std::string key(const std::string& name) {
+    std::string out = Utility::String::lowercase(name);
+    for(char& c: out) if(c == ' ') c = '_';
+    return out;
+}
+
+}
+
+ViewerProfiler::ViewerProfiler(const UnsignedInt maxFrameCount): _gl{
+    DebugTools::FrameProfilerGL::Value::FrameTime|
+    DebugTools::FrameProfilerGL::Value::CpuDuration|
+    DebugTools::FrameProfilerGL::Value::GpuDuration, maxFrameCount}
+{
+    using Measurement = DebugTools::FrameProfiler::Measurement;
+    using Units = DebugTools::FrameProfiler::Units;
+    _viewer.setup({
+        Measurement{"Layout step", Units::Nanoseconds, nothing, value<&Counters::layoutStepDuration>, &_counters},
+        Measurement{"Uploaded", Units::Bytes, nothing, value<&Counters::uploadedBytes>, &_counters},
+        Measurement{"Visible nodes", Units::Count, nothing, value<&Counters::visibleNodes>, &_counters},
+        Measurement{"Visible edges", Units::Count, nothing, value<&Counters::visibleEdges>, &_counters},
+        Measurement{"Labels", Units::Count, nothing, value<&Counters::labels>, &_counters}
+    }, maxFrameCount);
+
+    /* Both start enabled, profiling is opt-in here */
+    disable();
+}
+
+void ViewerProfiler::enable() {
+    _gl.enable();
+    _viewer.enable();
+}
+
+void ViewerProfiler::disable() {
+    _gl.disable();
+    _viewer.disable();
+}
+
+bool ViewerProfiler::setOutput(const std::string& filename) {
+    _output.close();
+    _output.clear();
+    _output.open(filename, std::ios::out|std::ios::trunc);
+    if(!_output) {
+        Error{} << "Can't open" << filename << "for writing";
+        return false;
+    }
+
+    _json = Utility::String::lowercase(Utility::Path::splitExtension(filename).second()) == ".json";
+    _frame = 0;
+
+    if(!_json) {
+        _output << "frame";
+        const DebugTools::FrameProfiler* const profilers[]{&_gl, &_viewer};
+        for(const DebugTools::FrameProfiler* profiler: profilers)
+            for(UnsignedInt i = 0; i != profiler->measurementCount(); ++i)
+                _output << ',' << key(profiler->measurementName(i));
+        _output << '\n';
+    }
+    return true;
+}
+
+void ViewerProfiler::setOverlayFont(Text::AbstractFont& font, Text::GlyphCache& cache) {
+    _overlay.emplace(font, cache, OverlaySize, Text::Alignment::TopLeft);
+    _overlay->reserve(1024, GL::BufferUsage::DynamicDraw, GL::BufferUsage::StaticDraw);
+    _overlayShader = Shaders::DistanceFieldVectorGL2D{};
+    _overlayShader.setColor(0xffffff_rgbf)
+        .setOutlineColor(0x202023_rgbf)
+        .setOutlineRange(0.5f, 0.3f)
+        .setSmoothness(0.6f/OverlaySize)
+        .bindVectorTexture(cache.texture());
+}
+
+void ViewerProfiler::beginFrame() {
+    _counters = Counters{};
+    _gl.beginFrame();
+    _viewer.beginFrame();
+}
+
+void ViewerProfiler::endFrame() {
+    if(!isEnabled()) return;
+
+    _viewer.endFrame();
+    _gl.endFrame();
+
+    if(_output.is_open()) writeFrame();
+    ++_frame;
+
+    if(_gl.measuredFrameCount() % StatisticsInterval != 0) return;
+    if(_overlay)
+        _overlay->render(_gl.statistics() + "\n" + _viewer.statistics());
+    else
+        Debug{} << _gl.statistics() << Debug::newline << _viewer.statistics();
+}
+
+void ViewerProfiler::writeFrame() {
+    /* GPU durations arrive a few frames late, so a row has the latest value
+       that's known at the time, empty / null if there's none yet */
+    if(_json) _output << "{\"frame\":" << _frame;
+    else _output << _frame;
+    const DebugTools::FrameProfiler* const profilers[]{&_gl, &_viewer};
+    for(const DebugTools::FrameProfiler* profiler: profilers) {
+        for(UnsignedInt i = 0; i != profiler->measurementCount(); ++i) {
+            UnsignedLong data;
+            const bool available = latest(*profiler, i, data);
+            if(_json) {
+                _output << ",\"" << key(profiler->measurementName(i)) << "\":";
+                if(available) _output << data;
+                else _output << "null";
+            } else {
+                _output << ',';
+                if(available) _output << data;
+            }
+        }
+    }
+    _output << (_json ? "}\n" : "\n");
+}
+
+void ViewerProfiler::drawOverlay(const Vector2i& windowSize) {
+    if(!isEnabled() || !_overlay || !_overlay->mesh().count()) return;
+
+    /* Pixel coordinates with the origin in the top left corner */
+    const Vector2 size{windowSize};
+    _overlayShader.setTransformationProjectionMatrix(
+        Matrix3::projection(size)*
+        Matrix3::translation(Vector2{-0.5f, 0.5f}*size + Vector2{1.0f, -1.0f}*OverlayMargin))
+        .draw(_overlay->mesh());
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef ViewerProfiler_h
+#define ViewerProfiler_h
+
+#include <fstream>
+#include <string>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/DebugTools/FrameProfiler.h>
+#include <Magnum/Shaders/DistanceFieldVectorGL.h>
+#include <Magnum/Text/Renderer.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* Frame profiling for the viewer. Frame time and CPU and GPU duration come
+   from DebugTools::FrameProfilerGL, next to it a plain FrameProfiler
+   collects what the viewer reports through counters() every frame. Results
+   are a moving average shown in an overlay if there's a font, printed to
+   the console otherwise, and optionally every frame is streamed to a CSV or
+   JSON Lines file. */
+class ViewerProfiler {
+    public:
+        /* Reset at the start of every frame */
+        struct Counters {
+            /* Duration of the last layout tick, in nanoseconds. Measured on
+               the layout thread, 0 if it's idle. */
+            UnsignedLong layoutStepDuration;
+            UnsignedLong uploadedBytes;
+            UnsignedLong visibleNodes;
+            UnsignedLong visibleEdges;
+            UnsignedLong labels;
+        };
+
+        explicit ViewerProfiler(UnsignedInt maxFrameCount = 60);
+
+        ViewerProfiler(const ViewerProfiler&) = delete;
+        ViewerProfiler& operator=(const ViewerProfiler&) = delete;
+
+        bool isEnabled() const { return _gl.isEnabled(); }
+        void enable();
+        void disable();
+
+        /* Streams the values of every frame into given file. A .json
+           extension writes one JSON object per line, anything else CSV. */
+        bool setOutput(const std::string& filename);
+
+        /* Draws the statistics in the top left corner instead of printing
+           them. The font and cache are expected to stay alive. */
+        void setOverlayFont(Text::AbstractFont& font, Text::GlyphCache& cache);
+
+        Counters& counters() { return _counters; }
+
+        void beginFrame();
+        void endFrame();
+
+        void drawOverlay(const Vector2i& windowSize);
+
+    private:
+        void writeFrame();
+
+        DebugTools::FrameProfilerGL _gl;
+        DebugTools::FrameProfiler _viewer;
+        Counters _counters{};
+
+        std::ofstream _output;
+        bool _json{};
+        UnsignedLong _frame{};
+
+        Containers::Pointer<Text::Renderer2D> _overlay;
+        Shaders::DistanceFieldVectorGL2D _overlayShader{NoCreate};
+};
+
+}
+
+#endif
@@ -0,0 +1,228 @@
+#include "VisitSketches.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <Corrade/Containers/StringStl.h>
+#include <Corrade/Utility/Assert.h>
+#include <Corrade/Utility/MurmurHash2.h>
+
+#include "GraphData.h"
+
+namespace Breadcrumbs {
+
+UnsignedLong sketchHash(const Containers::StringView key) {
+    /* The digest is a size_t, on 32-bit a second seed gives the upper
+       half */
+    UnsignedLong hash = 0;
+    std::memcpy(&hash, Utility::MurmurHash2{}(key.data(), key.size()).byteArray(), sizeof(std::size_t));
+    if(sizeof(std::size_t) < sizeof(UnsignedLong)) {
+        UnsignedLong upper = 0;
+        std::memcpy(&upper, Utility::MurmurHash2{0x9e3779b9}(key.data(), key.size()).byteArray(), sizeof(std::size_t));
+        hash |= upper << 32;
+    }
+    return hash;
+}
+
+namespace {
+
+/* Rows are indexed by h1 + i*h2 from the two halves of one hash
+   (Kirsch-Mitzenmacher), as independent as separate hashes for this */
+inline UnsignedInt rowIndex(const UnsignedLong hash, const UnsignedInt row, const UnsignedInt mask) {
+    return (UnsignedInt(hash) + row*(UnsignedInt(hash >> 32)|1)) & mask;
+}
+
+}
+
+CountMinTopK::CountMinTopK(const UnsignedInt k, const UnsignedInt width, const UnsignedInt depth): _k{k}, _depth{depth} {
+    UnsignedInt size = 1;
+    while(size < width) size <<= 1;
+    _widthMask = size - 1;
+    _counters = Containers::Array<UnsignedInt>{ValueInit, std::size_t(size)*depth};
+    _heap.reserve(k);
+}
+
+CountMinTopK::CountMinTopK(const CountMinTopK& other): _k{other._k}, _widthMask{other._widthMask}, _depth{other._depth}, _counters{NoInit, other._counters.size()}, _heap(other._heap), _heapPositions(other._heapPositions) {
+    std::copy(other._counters.begin(), other._counters.end(), _counters.begin());
+}
+
+CountMinTopK& CountMinTopK::operator=(const CountMinTopK& other) {
+    CountMinTopK copy{other};
+    return *this = std::move(copy);
+}
+
+UnsignedInt CountMinTopK::estimate(const UnsignedLong hash) const {
+    UnsignedInt out = ~UnsignedInt{};
+    for(UnsignedInt row = 0; row != _depth; ++row)
+        out = Math::min(out, _counters[row*(_widthMask + 1) + rowIndex(hash, row, _widthMask)]);
+    return out;
+}
+
+UnsignedInt CountMinTopK::estimate(const Containers::StringView key) const {
+    return estimate(sketchHash(key));
+}
+
+void CountMinTopK::add(const Containers::StringView key, const UnsignedInt count) {
+    const UnsignedLong hash = sketchHash(key);
+
+    /* Conservative update, only the counters that would end up below the
+       new estimate grow, which keeps collisions from inflating the others */
+    const UnsignedInt updated = estimate(hash) + count;
+    for(UnsignedInt row = 0; row != _depth; ++row) {
+        UnsignedInt& counter = _counters[row*(_widthMask + 1) + rowIndex(hash, row, _widthMask)];
+        counter = Math::max(counter, updated);
+    }
+
+    /* Most keys don't make it to the heap, which is decided without
+       touching the position map */
+    if(_heap.size() == _k && (!_k || updated <= _heap.front().count)) return;
+
+    const auto found = _heapPositions.find(hash);
+    if(found != _heapPositions.end()) {
+        _heap[found->second].count = updated;
+        siftDown(found->second);
+    } else if(_heap.size() < _k) {
+        /* Still filling the heap, the new entry sifts up */
+        _heap.push_back(Entry{updated, hash, key});
+        std::size_t i = _heap.size() - 1;
+        while(i && _heap[(i - 1)/2].count > _heap[i].count) {
+            std::swap(_heap[i], _heap[(i - 1)/2]);
+            _heapPositions[_heap[i].hash] = i;
+            i = (i - 1)/2;
+        }
+        _heapPositions[hash] = i;
+    } else {
+        _heapPositions.erase(_heap.front().hash);
+        _heap.front() = Entry{updated, hash, key};
+        _heapPositions[hash] = 0;
+        siftDown(0);
+    }
+}
+
+void CountMinTopK::siftDown(std::size_t i) {
+    for(;;) {
+        std::size_t smallest = i;
+        for(std::size_t child = 2*i + 1; child != 2*i + 3 && child < _heap.size(); ++child)
+            if(_heap[child].count < _heap[smallest].count) smallest = child;
+        if(smallest == i) break;
+        std::swap(_heap[i], _heap[smallest]);
+        _heapPositions[_heap[i].hash] = i;
+        i = smallest;
+    }
+    _heapPositions[_heap[i].hash] = i;
+}
+
+std::vector<std::pair<std::string, UnsignedInt>> CountMinTopK::top() const {
+    std::vector<std::pair<std::string, UnsignedInt>> out;
+    out.reserve(_heap.size());
+    for(const Entry& entry: _heap) out.emplace_back(entry.key, entry.count);
+    std::sort(out.begin(), out.end(), [](const std::pair<std::string, UnsignedInt>& a, const std::pair<std::string, UnsignedInt>& b) {
+        return a.second > b.second;
+    });
+    return out;
+}
+
+void CountMinTopK::rebuildHeap(std::vector<Entry>& candidates) {
+    std::sort(candidates.begin(), candidates.end(), [](const Entry& a, const Entry& b) {
+        return a.count > b.count;
+    });
+    if(candidates.size() > _k) candidates.resize(_k);
+    /* Descending order reversed is ascending, which is a valid min-heap */
+    std::reverse(candidates.begin(), candidates.end());
+    _heap = std::move(candidates);
+    _heapPositions.clear();
+    for(std::size_t i = 0; i != _heap.size(); ++i) _heapPositions[_heap[i].hash] = i;
+}
+
+void CountMinTopK::merge(const CountMinTopK& other) {
+    CORRADE_ASSERT(_widthMask == other._widthMask && _depth == other._depth,
+        "CountMinTopK::merge(): sketch sizes don't match", );
+    for(std::size_t i = 0; i != _counters.size(); ++i) _counters[i] += other._counters[i];
+
+    /* Both heaps are candidates, re-estimated against the sum */
+    std::vector<Entry> candidates = _heap;
+    for(const Entry& entry: other._heap)
+        if(_heapPositions.find(entry.hash) == _heapPositions.end()) candidates.push_back(entry);
+    for(Entry& entry: candidates) entry.count = estimate(entry.hash);
+    rebuildHeap(candidates);
+}
+
+void CountMinTopK::clear() {
+    std::fill(_counters.begin(), _counters.end(), 0u);
+    _heap.clear();
+    _heapPositions.clear();
+}
+
+HyperLogLog::HyperLogLog(const UnsignedInt precision): _precision{precision}, _registers{ValueInit, std::size_t{1} << precision} {
+    CORRADE_ASSERT(precision >= 4 && precision <= 18,
+        "HyperLogLog: precision expected to be between 4 and 18, got" << precision, );
+}
+
+HyperLogLog::HyperLogLog(const HyperLogLog& other): _precision{other._precision}, _registers{NoInit, other._registers.size()} {
+    std::copy(other._registers.begin(), other._registers.end(), _registers.begin());
+}
+
+HyperLogLog& HyperLogLog::operator=(const HyperLogLog& other) {
+    HyperLogLog copy{other};
+    return *this = std::move(copy);
+}
+
+void HyperLogLog::addHash(const UnsignedLong hash) {
+    /* Top bits pick the register, the rest gives the position of the first
+       set bit. A guard bit ends the count if they're all zero. */
+    const std::size_t index = hash >> (64 - _precision);
+    UnsignedLong rest = (hash << _precision)|(UnsignedLong{1} << (_precision - 1));
+#if defined(CORRADE_TARGET_GCC) || defined(CORRADE_TARGET_CLANG)
+    const UnsignedByte rank = __builtin_clzll(rest) + 1;
+#else
+    UnsignedByte rank = 1;
+    while(!(rest & (UnsignedLong{1} << 63))) {
+        rest <<= 1;
+        ++rank;
+    }
+#endif
+    _registers[index] = Math::max(_registers[index], rank);
+}
+
+Double HyperLogLog::estimate() const {
+    const Double m = _registers.size();
+    Double sum = 0.0;
+    std::size_t zeros = 0;
+    for(const UnsignedByte r: _registers) {
+        sum += std::ldexp(1.0, -Int(r));
+        if(!r) ++zeros;
+    }
+    const Double alpha = 0.7213/(1.0 + 1.079/m);
+    const Double raw = alpha*m*m/sum;
+    /* Linear counting is more accurate while many registers are empty */
+    if(raw <= 2.5*m && zeros) return m*std::log(m/zeros);
+    return raw;
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    CORRADE_ASSERT(_precision == other._precision,
+        "HyperLogLog::merge(): precisions don't match", );
+    for(std::size_t i = 0; i != _registers.size(); ++i)
+        _registers[i] = Math::max(_registers[i], other._registers[i]);
+}
+
+void HyperLogLog::clear() {
+    std::fill(_registers.begin(), _registers.end(), UnsignedByte{});
+}
+
+void VisitSketches::add(const std::string& tag, const std::string& link) {
+    domains.add(linkDomain(link));
+    pages.add(tag);
+}
+
+void VisitSketches::merge(const VisitSketches& other) {
+    domains.merge(other.domains);
+    pages.merge(other.pages);
+}
+
+void VisitSketches::clear() {
+    domains.clear();
+    pages.clear();
+}
+
+}
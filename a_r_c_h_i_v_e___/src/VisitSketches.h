@@ -0,0 +1,146 @@
+#ifndef VisitSketches_h
+#define VisitSketches_h
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/StringView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Functions.h>
+
+namespace Breadcrumbs {
+
+using namespace Magnum;
+
+/* 64-bit Utility::MurmurHash2 of a key, which all sketches below are
+   indexed by. Merged sketches have to agree on it, so it's fixed. */
+UnsignedLong sketchHash(Containers::StringView key);
+
+/* Count-Min sketch with a heap of the k keys with highest estimates. The
+   estimates never undercount, and overcount by at most a 2/width fraction
+   of the total with probability 1 - 1/2^depth. Sketches of the same size
+   merge by adding the counters, with the heaps re-ranked against the
+   sum, so each thread or shard can count on its own. */
+class CountMinTopK {
+    public:
+        /* Width is rounded up to a power of two */
+        explicit CountMinTopK(UnsignedInt k = 10, UnsignedInt width = 4096, UnsignedInt depth = 4);
+
+        CountMinTopK(const CountMinTopK& other);
+        CountMinTopK(CountMinTopK&&) noexcept = default;
+        CountMinTopK& operator=(const CountMinTopK& other);
+        CountMinTopK& operator=(CountMinTopK&&) noexcept = default;
+
+        void add(Containers::StringView key, UnsignedInt count = 1);
+
+        UnsignedInt estimate(Containers::StringView key) const;
+
+        /* Keys with their estimates, highest first */
+        std::vector<std::pair<std::string, UnsignedInt>> top() const;
+
+        void merge(const CountMinTopK& other);
+        void clear();
+
+    private:
+        struct Entry {
+            UnsignedInt count;
+            UnsignedLong hash;
+            std::string key;
+        };
+
+        UnsignedInt estimate(UnsignedLong hash) const;
+        void siftDown(std::size_t i);
+        void rebuildHeap(std::vector<Entry>& candidates);
+
+        UnsignedInt _k, _widthMask, _depth;
+        Containers::Array<UnsignedInt> _counters;
+        /* Min-heap by count, and where each hash is in it */
+        std::vector<Entry> _heap;
+        std::unordered_map<UnsignedLong, std::size_t> _heapPositions;
+};
+
+/* Distinct count estimate with a standard error of 1.04/sqrt(2^precision),
+   0.8% with the default of 16 kB of registers. Merges by taking the
+   maximum of each register. */
+class HyperLogLog {
+    public:
+        explicit HyperLogLog(UnsignedInt precision = 14);
+
+        HyperLogLog(const HyperLogLog& other);
+        HyperLogLog(HyperLogLog&&) noexcept = default;
+        HyperLogLog& operator=(const HyperLogLog& other);
+        HyperLogLog& operator=(HyperLogLog&&) noexcept = default;
+
+        void add(Containers::StringView key) { addHash(sketchHash(key)); }
+        void addHash(UnsignedLong hash);
+
+        Double estimate() const;
+
+        void merge(const HyperLogLog& other);
+        void clear();
+
+    private:
+        UnsignedInt _precision;
+        Containers::Array<UnsignedByte> _registers;
+};
+
+/* Top domains and distinct pages of a stream of visits */
+struct VisitSketches {
+    explicit VisitSketches(UnsignedInt topDomainCount = 10): domains{topDomainCount} {}
+
+    void add(const std::string& tag, const std::string& link);
+    void merge(const VisitSketches& other);
+    void clear();
+
+    CountMinTopK domains;
+    HyperLogLog pages;
+};
+
+/* A sliding window over a sketch, as a ring of slots each covering a fixed
+   stretch of time. Slots that fall out of the window get cleared for reuse,
+   a query merges the rest. Times are in the same units as the duration and
+   expected to be roughly increasing. */
+template<class T> class Windowed {
+    public:
+        explicit Windowed(const T& empty, UnsignedInt slotCount, Long slotDuration): _empty{empty}, _slots(slotCount, empty), _slotDuration{slotDuration}, _newest{}, _started{} {}
+
+        /* Sketch a visit at given time goes to, nullptr if the time is
+           already out of the window */
+        T* at(Long time) {
+            const Long slot = time >= 0 ? time/_slotDuration : (time + 1)/_slotDuration - 1;
+            const Long count = _slots.size();
+            if(!_started) {
+                _newest = slot;
+                _started = true;
+            } else if(slot > _newest) {
+                for(Long i = Math::max(_newest + 1, slot - count + 1); i <= slot; ++i)
+                    _slots[index(i)].clear();
+                _newest = slot;
+            } else if(slot <= _newest - count) return nullptr;
+            return &_slots[index(slot)];
+        }
+
+        /* Everything in the window ending at the newest time seen */
+        T merged() const {
+            T out = _empty;
+            for(const T& slot: _slots) out.merge(slot);
+            return out;
+        }
+
+    private:
+        std::size_t index(Long slot) const {
+            const Long count = _slots.size();
+            return ((slot % count) + count) % count;
+        }
+
+        T _empty;
+        std::vector<T> _slots;
+        Long _slotDuration, _newest;
+        bool _started;
+};
+
+}
+
+#endif
@@ -0,0 +1,273 @@
+#include "VulkanForces.h"
+
+#include <cmath>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/Reference.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Vk/CommandPoolCreateInfo.h>
+#include <Magnum/Vk/ComputePipelineCreateInfo.h>
+#include <Magnum/Vk/DescriptorPoolCreateInfo.h>
+#include <Magnum/Vk/DescriptorSetLayoutCreateInfo.h>
+#include <Magnum/Vk/DescriptorType.h>
+#include <Magnum/Vk/DeviceCreateInfo.h>
+#include <Magnum/Vk/DeviceProperties.h>
+#include <Magnum/Vk/InstanceCreateInfo.h>
+#include <Magnum/Vk/PipelineLayoutCreateInfo.h>
+#include <Magnum/Vk/Result.h>
+#include <Magnum/Vk/Shader.h>
+#include <Magnum/Vk/ShaderCreateInfo.h>
+#include <Magnum/Vk/ShaderSet.h>
+
+#include "ForceLayout.h"
+
+namespace Breadcrumbs {
+
+namespace {
+
+/* Matches the uniform block in both shaders */
+struct Parameters {
+    Float alpha;
+    UnsignedInt nodeCount;
+    UnsignedInt linkCount;
+    Float chargeStrength;
+    Float linkDistance;
+};
+
+constexpr UnsignedInt WorkgroupSize = 64;
+
+/* The CPU reference tick is O(n^2) with exact charge, so the check runs on
+   a prefix of the graph */
+constexpr UnsignedInt CheckNodeCount = 1024;
+
+/* Relative RMS difference of velocities allowed in the check. The link pass
+   differs in update order from the CPU one, which at AlphaMin makes about
+   0.1%, and the charge alone matches to 1e-4; anything over means the device
+   computes garbage. */
+constexpr Float CheckTolerance = 0.01f;
+
+}
+
+Containers::Pointer<VulkanForces> VulkanForces::tryCreate(const ForceLayout& layout, const Int argc, char** const argv) {
+    Containers::Pointer<VulkanForces> forces{new VulkanForces};
+    if(!forces->create(argc, argv)) return nullptr;
+
+    /* A tick of a subgraph with both implementations, from the same
+       positions and at alpha low enough for the update order not to
+       matter */
+    const UnsignedInt checkNodeCount = Math::min(UnsignedInt(layout.nodeCount()), CheckNodeCount);
+    Containers::Array<Vector2ui> checkLinks;
+    for(const Vector2ui& link: layout.links())
+        if(link.max() < checkNodeCount) arrayAppend(checkLinks, link);
+    const Containers::ArrayView<const Vector2> positions = layout.positions().prefix(checkNodeCount);
+    ForceLayout cpu{checkNodeCount, checkLinks};
+    cpu.setPositions(positions)
+        .setAlpha(ForceLayout::AlphaMin)
+        .setTheta(0.0f)
+        .step();
+    ForceLayout vulkan{checkNodeCount, checkLinks};
+    forces->setGraph(vulkan);
+
+    /* The rest of step() done by hand, as it's done by ForceLayout */
+    const Float alpha = cpu.alpha();
+    Containers::Array<Vector2> velocities{ValueInit, checkNodeCount};
+    forces->apply(positions, velocities, alpha);
+    Double difference = 0.0, magnitude = 0.0;
+    for(std::size_t i = 0; i != checkNodeCount; ++i) {
+        const Vector2 velocity = (velocities[i] - positions[i]*ForceLayout::CenterStrength*alpha)*(1.0f - ForceLayout::VelocityDecay);
+        difference += (velocity - cpu.velocities()[i]).dot();
+        magnitude += cpu.velocities()[i].dot();
+    }
+    if(difference > CheckTolerance*CheckTolerance*magnitude) {
+        Warning{} << "Vulkan layout forces differ from the CPU ones by" << Float(std::sqrt(difference/magnitude))*100.0f << Debug::nospace << "%, not using them";
+        return nullptr;
+    }
+
+    forces->setGraph(layout);
+    return forces;
+}
+
+VulkanForces::VulkanForces() = default;
+
+VulkanForces::~VulkanForces() = default;
+
+bool VulkanForces::create(const Int argc, char** const argv) {
+    if(_instance.tryCreate(Vk::InstanceCreateInfo{argc, argv}) != Vk::Result::Success)
+        return false;
+    Containers::Optional<Vk::DeviceProperties> properties = Vk::tryPickDevice(_instance);
+    if(!properties) return false;
+    const Containers::Optional<UnsignedInt> family = properties->tryPickQueueFamily(Vk::QueueFlag::Compute);
+    if(!family) {
+        Warning{} << "No compute queue on" << properties->name();
+        return false;
+    }
+    Debug{} << "Layout forces on" << properties->name();
+    Vk::DeviceCreateInfo deviceInfo{std::move(*properties)};
+    deviceInfo.addQueues(*family, {0.0f}, {_queue});
+    if(_device.tryCreate(_instance, std::move(deviceInfo)) != Vk::Result::Success)
+        return false;
+
+    /* Both pipelines share one set, each uses only some of the bindings */
+    _descriptorSetLayout = Vk::DescriptorSetLayout{_device, Vk::DescriptorSetLayoutCreateInfo{
+        {{0, Vk::DescriptorType::UniformBuffer}},
+        {{1, Vk::DescriptorType::StorageBuffer}},
+        {{2, Vk::DescriptorType::StorageBuffer}},
+        {{3, Vk::DescriptorType::StorageBuffer}},
+        {{4, Vk::DescriptorType::StorageBuffer}},
+        {{5, Vk::DescriptorType::StorageBuffer}},
+        {{6, Vk::DescriptorType::StorageBuffer}},
+        {{7, Vk::DescriptorType::StorageBuffer}}
+    }};
+    _descriptorPool = Vk::DescriptorPool{_device, Vk::DescriptorPoolCreateInfo{1, {
+        {Vk::DescriptorType::UniformBuffer, 1},
+        {Vk::DescriptorType::StorageBuffer, 7}
+    }}};
+    _descriptorSet = _descriptorPool.allocate(_descriptorSetLayout);
+    _pipelineLayout = Vk::PipelineLayout{_device, Vk::PipelineLayoutCreateInfo{_descriptorSetLayout}};
+
+    /* Compiled to SPIR-V at build time. Copied out of the resource to have
+       the code four-byte aligned. */
+    const Utility::Resource rs{"breadcrumbs-vulkan"};
+    const auto pipeline = [&](const char* filename) {
+        const Containers::ArrayView<const char> code = rs.getRaw(filename);
+        Containers::Array<UnsignedInt> aligned{NoInit, code.size()/4};
+        Utility::copy(code.prefix(aligned.size()*4), Containers::arrayCast<char>(aligned));
+        Vk::Shader shader{_device, Vk::ShaderCreateInfo{std::move(aligned)}};
+        Vk::ShaderSet shaderSet;
+        shaderSet.addShader(Vk::ShaderStage::Compute, shader, "main");
+        return Vk::Pipeline{_device, Vk::ComputePipelineCreateInfo{shaderSet, _pipelineLayout}};
+    };
+    _chargePipeline = pipeline("ForceCharge.spv");
+    _linkPipeline = pipeline("ForceLinks.spv");
+
+    _commandPool = Vk::CommandPool{_device, Vk::CommandPoolCreateInfo{*family}};
+    _fence = Vk::Fence{_device};
+    return true;
+}
+
+Vk::Buffer VulkanForces::createBuffer(const Vk::BufferUsage usage, const std::size_t size) {
+    /* Zero-sized buffers aren't allowed, which happens for graphs without
+       links */
+    return Vk::Buffer{_device, Vk::BufferCreateInfo{usage, Math::max(size, std::size_t{4})},
+        Vk::MemoryFlag::HostVisible|Vk::MemoryFlag::HostCoherent};
+}
+
+void VulkanForces::setGraph(const ForceLayout& layout) {
+    _nodeCount = layout.nodeCount();
+    const Containers::ArrayView<const Vector2ui> links = layout.links();
+
+    /* Links incident to each node, a self-loop only once as the shader
+       handles both of its ends in one go */
+    Containers::Array<UnsignedInt> incidenceOffsets{ValueInit, _nodeCount + 1};
+    for(const Vector2ui& link: links) {
+        ++incidenceOffsets[link.x() + 1];
+        if(link.y() != link.x()) ++incidenceOffsets[link.y() + 1];
+    }
+    for(std::size_t i = 0; i != _nodeCount; ++i)
+        incidenceOffsets[i + 1] += incidenceOffsets[i];
+    Containers::Array<UnsignedInt> incidence{NoInit, incidenceOffsets[_nodeCount]};
+    {
+        Containers::Array<UnsignedInt> fill{NoInit, _nodeCount};
+        Utility::copy(incidenceOffsets.prefix(_nodeCount), fill);
+        for(std::size_t i = 0; i != links.size(); ++i) {
+            incidence[fill[links[i].x()]++] = i;
+            if(links[i].y() != links[i].x()) incidence[fill[links[i].y()]++] = i;
+        }
+    }
+    Containers::Array<Vector2> linkParameters{NoInit, links.size()};
+    for(std::size_t i = 0; i != links.size(); ++i)
+        linkParameters[i] = {layout.linkStrengths()[i], layout.linkBiases()[i]};
+
+    /* Mappings have to go before the buffers they point to */
+    _mappedParameters = nullptr;
+    _mappedPositions = nullptr;
+    _mappedVelocities = nullptr;
+
+    _parameters = createBuffer(Vk::BufferUsage::UniformBuffer, sizeof(Parameters));
+    _positions = createBuffer(Vk::BufferUsage::StorageBuffer, _nodeCount*sizeof(Vector2));
+    _velocities = createBuffer(Vk::BufferUsage::StorageBuffer, _nodeCount*sizeof(Vector2));
+    _charged = createBuffer(Vk::BufferUsage::StorageBuffer, _nodeCount*sizeof(Vector2));
+    _links = createBuffer(Vk::BufferUsage::StorageBuffer, links.size()*sizeof(Vector2ui));
+    _linkParameters = createBuffer(Vk::BufferUsage::StorageBuffer, linkParameters.size()*sizeof(Vector2));
+    _incidenceOffsets = createBuffer(Vk::BufferUsage::StorageBuffer, incidenceOffsets.size()*sizeof(UnsignedInt));
+    _incidence = createBuffer(Vk::BufferUsage::StorageBuffer, incidence.size()*sizeof(UnsignedInt));
+
+    /* Fixed data is uploaded once, the rest stays mapped */
+    const auto upload = [](Vk::Buffer& buffer, const Containers::ArrayView<const void> data) {
+        Containers::Array<char, Vk::MemoryMapDeleter> mapped = buffer.dedicatedMemory().map();
+        Utility::copy(Containers::arrayCast<const char>(data), mapped.prefix(data.size()));
+    };
+    upload(_links, links);
+    upload(_linkParameters, linkParameters);
+    upload(_incidenceOffsets, incidenceOffsets);
+    upload(_incidence, incidence);
+    _mappedParameters = _parameters.dedicatedMemory().map();
+    _mappedPositions = _positions.dedicatedMemory().map();
+    _mappedVelocities = _velocities.dedicatedMemory().map();
+
+    Parameters& parameters = *reinterpret_cast<Parameters*>(_mappedParameters.data());
+    parameters.alpha = 0.0f;
+    parameters.nodeCount = _nodeCount;
+    parameters.linkCount = links.size();
+    parameters.chargeStrength = ForceLayout::ChargeStrength;
+    parameters.linkDistance = ForceLayout::LinkDistance;
+
+    /* Magnum doesn't wrap descriptor writes yet */
+    Vk::Buffer* const buffers[]{
+        &_parameters, &_positions, &_velocities, &_charged,
+        &_links, &_linkParameters, &_incidenceOffsets, &_incidence
+    };
+    VkDescriptorBufferInfo bufferInfos[Containers::arraySize(buffers)];
+    VkWriteDescriptorSet writes[Containers::arraySize(buffers)];
+    for(UnsignedInt i = 0; i != Containers::arraySize(buffers); ++i) {
+        bufferInfos[i] = {*buffers[i], 0, VK_WHOLE_SIZE};
+        writes[i] = {};
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = _descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    _device->UpdateDescriptorSets(_device, Containers::arraySize(writes), writes, 0, nullptr);
+
+    /* Same work every tick, so it's recorded just once. Dispatches aren't
+       wrapped either. */
+    const UnsignedInt groupCount = (_nodeCount + WorkgroupSize - 1)/WorkgroupSize;
+    const VkDescriptorSet descriptorSet = _descriptorSet;
+    _commandBuffer = _commandPool.allocate();
+    _commandBuffer.begin()
+        .bindPipeline(_chargePipeline);
+    _device->CmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    _device->CmdDispatch(_commandBuffer, groupCount, 1, 1);
+    _commandBuffer
+        .pipelineBarrier(Vk::PipelineStage::ComputeShader, Vk::PipelineStage::ComputeShader, {
+            {Vk::Access::ShaderWrite, Vk::Access::ShaderRead}
+        })
+        .bindPipeline(_linkPipeline);
+    _device->CmdDispatch(_commandBuffer, groupCount, 1, 1);
+    _commandBuffer
+        .pipelineBarrier(Vk::PipelineStage::ComputeShader, Vk::PipelineStage::Host, {
+            {Vk::Access::ShaderWrite, Vk::Access::HostRead}
+        })
+        .end();
+}
+
+void VulkanForces::apply(const Containers::ArrayView<const Vector2> positions, const Containers::ArrayView<Vector2> velocities, const Float alpha) {
+    if(!_nodeCount) return;
+
+    reinterpret_cast<Parameters*>(_mappedParameters.data())->alpha = alpha;
+    const std::size_t size = _nodeCount*sizeof(Vector2);
+    Utility::copy(Containers::arrayCast<const char>(positions), _mappedPositions.prefix(size));
+    Utility::copy(Containers::arrayCast<const char>(velocities), _mappedVelocities.prefix(size));
+
+    _fence.reset();
+    _queue.submit({Vk::SubmitInfo{}.setCommandBuffers({_commandBuffer})}, _fence);
+    _fence.wait();
+
+    Utility::copy(_mappedVelocities.prefix(size), Containers::arrayCast<char>(velocities));
+}
+
+}
@@ -0,0 +1,95 @@
+#ifndef VulkanForces_h
+#define VulkanForces_h
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/Vk/Buffer.h>
+#include <Magnum/Vk/BufferCreateInfo.h>
+#include <Magnum/Vk/CommandBuffer.h>
+#include <Magnum/Vk/CommandPool.h>
+#include <Magnum/Vk/DescriptorPool.h>
+#include <Magnum/Vk/DescriptorSet.h>
+#include <Magnum/Vk/DescriptorSetLayout.h>
+#include <Magnum/Vk/Device.h>
+#include <Magnum/Vk/Fence.h>
+#include <Magnum/Vk/Instance.h>
+#include <Magnum/Vk/Memory.h>
+#include <Magnum/Vk/Pipeline.h>
+#include <Magnum/Vk/PipelineLayout.h>
+#include <Magnum/Vk/Queue.h>
+
+#include "ForceBackend.h"
+
+namespace Breadcrumbs {
+
+class ForceLayout;
+
+/* ForceLayout charge and link passes as two Vulkan compute dispatches. The
+   charge is computed exactly in O(n^2), which on a GPU is still faster than
+   Barnes-Hut on a CPU for any graph that fits on screen. Buffers are
+   host-visible and stay mapped, so a tick is a copy of the position and
+   velocity arrays in, one submit and a copy of the velocities out.
+
+   Links are all applied from the same state instead of one after another
+   like in d3, so a single tick differs from the CPU one roughly by alpha in
+   relative terms, which is a lot in the first ticks. The layout it settles
+   to is equivalent, with the same mean link length and spread to within a
+   percent, just not the same arrangement.
+
+   Works on any device with a compute queue, including CPU implementations
+   like Mesa lavapipe or SwiftShader on machines without a GPU, which
+   --magnum-device cpu picks. */
+class VulkanForces: public ForceBackend {
+    public:
+        /* Returns null with a message printed if there's no usable device,
+           or if a test tick on it doesn't match the CPU implementation */
+        static Containers::Pointer<VulkanForces> tryCreate(const ForceLayout& layout, Int argc, char** argv);
+
+        ~VulkanForces();
+
+        const char* name() const override { return "Vulkan"; }
+
+        void apply(Containers::ArrayView<const Vector2> positions, Containers::ArrayView<Vector2> velocities, Float alpha) override;
+
+    private:
+        explicit VulkanForces();
+
+        bool create(Int argc, char** argv);
+        Vk::Buffer createBuffer(Vk::BufferUsage usage, std::size_t size);
+        /* Replaces all buffers and re-records the command buffer */
+        void setGraph(const ForceLayout& layout);
+
+        Vk::Instance _instance{NoCreate};
+        Vk::Device _device{NoCreate};
+        Vk::Queue _queue{NoCreate};
+        Vk::CommandPool _commandPool{NoCreate};
+        Vk::CommandBuffer _commandBuffer{NoCreate};
+        Vk::Fence _fence{NoCreate};
+
+        Vk::DescriptorSetLayout _descriptorSetLayout{NoCreate};
+        Vk::DescriptorPool _descriptorPool{NoCreate};
+        Vk::DescriptorSet _descriptorSet{NoCreate};
+        Vk::PipelineLayout _pipelineLayout{NoCreate};
+        Vk::Pipeline _chargePipeline{NoCreate}, _linkPipeline{NoCreate};
+
+        /* In binding order, velocities are both the input and the output */
+        Vk::Buffer _parameters{NoCreate},
+            _positions{NoCreate},
+            _velocities{NoCreate},
+            _charged{NoCreate},
+            _links{NoCreate},
+            _linkParameters{NoCreate},
+            _incidenceOffsets{NoCreate},
+            _incidence{NoCreate};
+
+        /* Declared after the buffers so they get unmapped first */
+        Containers::Array<char, Vk::MemoryMapDeleter> _mappedParameters,
+            _mappedPositions,
+            _mappedVelocities;
+
+        UnsignedInt _nodeCount{};
+};
+
+}
+
+#endif
@@ -16,7 +16,50 @@ const simulation = d3.forceSimulation()
   .force('x',      d3.forceX())
   .force('y',      d3.forceY());
 
-const main = () => d3.json('data.json', (error, graph) => {
+// local graph server (a_r_c_h_i_v_e___/data/serve.cpp), only the part of the
+// graph around one node is fetched. data.json is the fallback when the
+// server isn't running.
+const server = 'http://127.0.0.1:8080',
+      hops   = 2,
+      limit  = 500;
+
+// node the view is centred on, "?node=<tag>" in the page URL
+const centre = new URLSearchParams(window.location.search).get('node');
+
+const domain = link => {
+  try { return new URL(link).hostname; } catch (e) { return link; }
+};
+
+// server nodes and links in the shape of data.json, coloured by domain
+const fromServer = graph => ({
+  nodes: graph.nodes.map(node => ({
+    id:     node.id,
+    user:   domain(node.link),
+    group:  domain(node.link),
+    link:   node.link,
+    visits: node.visits,
+  })),
+  links: graph.links.map(link => ({ source: link.source, target: link.target, value: link.weight })),
+});
+
+const subgraph = (node, callback) =>
+  d3.json(`${server}/subgraph?node=${encodeURIComponent(node)}&hops=${hops}&limit=${limit}`,
+    (error, graph) => callback(error, graph && fromServer(graph)));
+
+const load = callback => {
+  const fallback = () => d3.json('data.json', callback);
+  const loaded   = (error, graph) => error ? fallback() : callback(null, graph);
+
+  if (centre) return subgraph(centre, loaded);
+
+  // without one, around the best linked node of the largest cluster
+  d3.json(`${server}/clusters?limit=1`, (error, clusters) => {
+    if (error || !clusters.clusters.length) return fallback();
+    subgraph(clusters.clusters[0].hub.id, loaded);
+  });
+};
+
+const main = () => load((error, graph) => {
   if (error) throw error;
 
   document.body.appendChild(renderer.view);